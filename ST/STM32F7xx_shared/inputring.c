@@ -0,0 +1,67 @@
+/******************************************************************************
+ * INCLUDE FILES
+ ******************************************************************************/
+
+#include "inputring.h"
+
+/******************************************************************************
+ * DEFINES
+ ******************************************************************************/
+
+#define INPUT_RING_MASK     (INPUT_RING_SIZE - 1)
+
+/******************************************************************************
+ * LOCAL DATA DEFINITIONS
+ ******************************************************************************/
+
+// head and tail count events ever pushed and popped; they only wrap
+// as uint32_t, so head - tail is always the number of queued events.
+// head is only written by the producer, tail only by the consumer.
+static input_event_t g_ring[INPUT_RING_SIZE];
+static uint32_t g_head;
+static uint32_t g_tail;
+static uint32_t g_dropped;
+
+/******************************************************************************
+ * FUNCTION BODIES
+ ******************************************************************************/
+
+int input_ring_push(const input_event_t* ev)
+{
+    const uint32_t head = g_head;
+    const uint32_t tail = __atomic_load_n(&g_tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= INPUT_RING_SIZE)
+    {
+        g_dropped++;
+        return 0;
+    }
+
+    g_ring[head & INPUT_RING_MASK] = *ev;
+    // publish the event only after it is written
+    __atomic_store_n(&g_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+int input_ring_pop(input_event_t* ev)
+{
+    const uint32_t tail = g_tail;
+    const uint32_t head = __atomic_load_n(&g_head, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+    {
+        return 0;
+    }
+
+    *ev = g_ring[tail & INPUT_RING_MASK];
+    // hand the slot back only after it is read
+    __atomic_store_n(&g_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+uint32_t input_ring_dropped(void)
+{
+    return __atomic_load_n(&g_dropped, __ATOMIC_RELAXED);
+}
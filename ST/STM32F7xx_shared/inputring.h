@@ -0,0 +1,39 @@
+#ifndef __INPUTRING_H
+#define __INPUTRING_H
+
+/******************************************************************************
+ * INCLUDE FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/******************************************************************************
+ * DEFINES
+ ******************************************************************************/
+
+// Events the ring holds. 115200 baud is ~12 bytes/ms, so this covers
+// a burst of ~20 ms of back to back bytes, e.g. a frame on a slow level.
+#define INPUT_RING_SIZE     256 // must be power of 2
+
+/******************************************************************************
+ * TYPEDEFS
+ ******************************************************************************/
+
+typedef struct
+{
+    uint64_t time;      // I_GetTimeUS when the event was received
+    uint8_t key;        // doom key code
+    uint8_t pressed;    // 1 = press, 0 = release
+} input_event_t;
+
+/******************************************************************************
+ * FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+// Single producer (the UART ISR), single consumer (the game loop).
+// Neither side disables interrupts or blocks.
+int input_ring_push(const input_event_t* ev); /* producer, 0 if full */
+int input_ring_pop(input_event_t* ev); /* consumer, 0 if empty */
+uint32_t input_ring_dropped(void); /* events lost because the ring was full */
+
+#endif /* __INPUTRING_H */
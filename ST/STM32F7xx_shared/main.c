@@ -21,14 +21,15 @@
 
 #include "main_stm32f7xx.h"
 #include "doomkeys.h"
+#include "inputring.h"
 #include "memusage.h"
 
 /******************************************************************************
  * DEFINES
  ******************************************************************************/
 
-#define UART_RX_BUF_SIZE     2   // must be power of 2
 #define UART_KEY_HOLD_MS     100 // mark a key as released after xxx ms over uart
+#define MAX_HELD_KEYS        16  // keys tracked as held at the same time
 
 #define VSYNC_TIMEOUT_MS     1000 // Self Monitor: if there is no VSYNC
                                   // interrupt for more than X milliseconds,
@@ -38,6 +39,9 @@
                                   // itself for more than X milliseconds we
                                   // need to reset.
 
+#define AUDIO_TICK_US        1000 // sound mixer timer period, must be well
+                                  // under snd_maxslicetime_ms
+
 /******************************************************************************
  * TYPEDEFS
  ******************************************************************************/
@@ -46,13 +50,12 @@
  * GLOBAL DATA DEFINITIONS
  ******************************************************************************/
 
-// UART
-static volatile uint8_t g_uart_rx_buf[UART_RX_BUF_SIZE];
-static volatile int g_uart_rx_buf_size; // number of bytes in g_uart_rx_buf
-
 // Framebuffer Pointer
 uint8_t* STM32_ScreenBuffer;
 
+// Sound mixer timer, serviced in stm32f7xx_it.c
+TIM_HandleTypeDef htim7;
+
 /******************************************************************************
  * LOCAL DATA DEFINITIONS
  ******************************************************************************/
@@ -63,9 +66,18 @@ static uint32_t g_fblist[2]; // address of framebuffers
 static volatile bool g_double_buffer_enabled = false; // initially set false
 static volatile int g_fbcur = 1; // index into g_fblist, start in invisible buffer
 static volatile uint32_t g_vsync_count;
+static volatile uint32_t g_vsync_total; // vsyncs since start, for the frame pacer
+static uint64_t g_vsync_time; // I_GetTimeUS of the last vsync
 
 // Self Monitoring
 extern int gametic; // dooms internal timer from d_loop.c
+extern int sightcachehits; // P_CheckSight answered from cache (p_sight.c)
+extern int sightcachemisses; // P_CheckSight BSP traversals (p_sight.c)
+extern int pacerslack; // us the last frame was ready before its vsync (d_pacer.c)
+extern void D_PacerLatency(int *ticcmd, int *present); // input latency (d_pacer.c)
+extern void I_MixSoundStats(int *mixus, int *underruns); // sound mixer (i_mixsound.c)
+extern void I_MixSoundCacheStats(int *convertus, int *hitrate, int *cachekb);
+extern void I_OPLMusicStats(int *synthus); // OPL music (i_oplmusic.c)
 static volatile uint32_t g_last_vsync;
 static int g_last_seen_gametic; // monitor gametic
 static uint32_t g_last_gametic_change_time; // timestamp of last gametic change
@@ -80,6 +92,9 @@ static void self_monitoring(void);
 // Keyboard Input
 static int map_ascii_to_doom(uint8_t c);
 
+// Sound
+static void audio_timer_init(void);
+
 /******************************************************************************
  * FUNCTION PROTOTYPES
  ******************************************************************************/
@@ -105,6 +120,8 @@ static void board_common_init_post(void)
     printf("Total heap size: %u bytes\n", heap_total());
 
     STM32_ScreenBuffer = (uint8_t*)g_fblist[g_fbcur];
+
+    audio_timer_init();
 }
 
 int main(void)
@@ -119,7 +136,10 @@ int main(void)
 
     uint32_t cyclecount = 0;
     uint32_t fpscounter = 0;
-    uint32_t nextfpsupdate = HAL_GetTick() + 1000;
+    uint64_t nextfpsupdate = I_GetTimeUS() + 1000000;
+    int lastgametic = gametic;
+    int lastsighthits = 0;
+    int lastsightmisses = 0;
 
     while (1)
     {
@@ -133,20 +153,45 @@ int main(void)
         self_monitoring();
         cyclecount += DWT->CYCCNT - cyclestart; // count cycles used for this frame
 
-        if (HAL_GetTick() > nextfpsupdate) // emit some debug info to printf/UART
+        if (I_GetTimeUS() >= nextfpsupdate) // emit some debug info to printf/UART
         {
             float cpuload = (float)cyclecount / HAL_RCC_GetHCLKFreq();
             if (cpuload > 1.0f) { cpuload = 1.0f; }
-            printf("FPS%3i CPU%3u%% VID%3uHz Stack %u/%u Heap %u/%uKB Zone %u/%uM gametic: %i time %u\n",
+            // sight cache: hit rate and BSP traversals saved per game tic
+            const int tics = gametic - lastgametic;
+            const int sighthits = sightcachehits - lastsighthits;
+            const int sightchecks = sighthits + sightcachemisses - lastsightmisses;
+            // input to ticcmd and input to screen latency
+            int latticcmd, latpresent;
+            D_PacerLatency(&latticcmd, &latpresent);
+            // sound mixing time per timer tick and underruns
+            int mixus, mixunderruns;
+            I_MixSoundStats(&mixus, &mixunderruns);
+            // sound effect conversion time, cache hit rate and size
+            int sfxconvus, sfxhitrate, sfxcachekb;
+            I_MixSoundCacheStats(&sfxconvus, &sfxhitrate, &sfxcachekb);
+            // music synthesis time over the last second
+            int musus;
+            I_OPLMusicStats(&musus);
+            printf("FPS%3i CPU%3u%% VID%3uHz Stack %u/%u Heap %u/%uKB Zone %u/%uM Sight%3i%% %i/tic Slack%6ius Lat %i/%ius Mix%5ius %i xrun Sfx%3i%% %iKB %ius Mus%6ius gametic: %i time %u\n",
                    fpscounter, (int)(cpuload * 100), g_vsync_count,
                    stack_usage(), stack_total(),
                    heap_usage()/1024, heap_total()/1024,
                    Z_ZoneUsage()/(1024*1024), Z_ZoneSize()/(1024*1024),
+                   sightchecks ? sighthits * 100 / sightchecks : 0,
+                   tics ? sighthits / tics : 0,
+                   pacerslack, latticcmd, latpresent,
+                   mixus, mixunderruns,
+                   sfxhitrate, sfxcachekb, sfxconvus,
+                   musus,
                    gametic, HAL_GetTick());
+            lastgametic = gametic;
+            lastsighthits = sightcachehits;
+            lastsightmisses = sightcachemisses;
             fpscounter = 0;
             cyclecount = 0;
             g_vsync_count = 0;
-            nextfpsupdate += 1000;
+            nextfpsupdate += 1000000;
         }
         /* wait until VSYNC (HAL_LTDC_LineEventCallback) has consumed the
          * latest frame: */
@@ -171,8 +216,23 @@ void HAL_LTDC_LineEventCallback(LTDC_HandleTypeDef *hltdc)
         g_frame_ready = 0;
     }
     g_last_vsync = HAL_GetTick();
+    g_vsync_time = I_GetTimeUS();
     HAL_LTDC_ProgramLineEvent(hltdc, 0); // setup next VSYNC callback
     g_vsync_count++;
+    g_vsync_total++;
+}
+
+// called by TryRunTics() to pace frames against the display
+uint32_t I_GetVsync(uint64_t *time)
+{
+    uint32_t count;
+
+    __disable_irq(); // g_vsync_time is not written atomically
+    *time = g_vsync_time;
+    count = g_vsync_total;
+    __enable_irq();
+
+    return count;
 }
 
 // called by I_FinishUpdate() to signal that the buffer is ready
@@ -279,44 +339,61 @@ static int map_ascii_to_doom(uint8_t c)
     }
 }
 
-static uint8_t keypressed[256]; // key pressed state
-static uint32_t keypressedlast[256]; // key pressed time
-int DG_GetKey(int* pressed, unsigned char* doomKey)
+// Keys held down: a UART terminal only sends key presses (repeated
+// while a key is held), so a key counts as released once no press
+// has been seen for UART_KEY_HOLD_MS.
+static struct
 {
-    uint32_t time = HAL_GetTick();
+    uint8_t key;
+    uint64_t time; // last press
+} g_held[MAX_HELD_KEYS];
+static int g_numheld;
 
-    while (g_uart_rx_buf_size > 0)
+int DG_GetKey(int* pressed, unsigned char* doomKey, uint64_t* eventTime)
+{
+    input_event_t ev;
+
+    while (input_ring_pop(&ev))
     {
-        __disable_irq(); // disable interrupts
-        g_uart_rx_buf_size--;
-        uint8_t key = g_uart_rx_buf[g_uart_rx_buf_size];
-        __enable_irq(); // enable interrupts
+        int i;
 
-        key = map_ascii_to_doom(key);
-        if (key)
+        for (i = 0; i < g_numheld; i++)
         {
-            keypressed[key] = 1;
-            keypressedlast[key] = time; // record the time of the key press
-
-            *pressed = 1; // key is pressed
-            *doomKey = key;
+            if (g_held[i].key == ev.key)
+                break;
+        }
 
-            return 1; // key found
+        if (ev.pressed)
+        {
+            if (i == g_numheld)
+            {
+                if (g_numheld == MAX_HELD_KEYS)
+                    continue; // too many keys at once, ignore this one
+                g_held[g_numheld++].key = ev.key;
+            }
+            g_held[i].time = ev.time;
+        }
+        else if (i < g_numheld)
+        {
+            g_held[i] = g_held[--g_numheld];
         }
+
+        *pressed = ev.pressed;
+        *doomKey = ev.key;
+        *eventTime = ev.time;
+        return 1; // key found
     }
 
-    int debounce = UART_KEY_HOLD_MS;
-    for (int i=0; i<256; i++)
+    const uint64_t time = I_GetTimeUS();
+    for (int i = 0; i < g_numheld; i++)
     {
-        if (!keypressed[i])
-            continue;
-
         // check if the key is still pressed
-        if (time - keypressedlast[i] > debounce)
+        if (time - g_held[i].time > UART_KEY_HOLD_MS * 1000)
         {
-            keypressed[i] = 0;
             *pressed = 0;
-            *doomKey = i;
+            *doomKey = g_held[i].key;
+            *eventTime = time;
+            g_held[i] = g_held[--g_numheld];
             return 1; // key is no longer pressed
         }
     }
@@ -377,10 +454,43 @@ static void self_monitoring(void)
 
 void I_StdinByteRecv(uint8_t byte) /* called from an ISR */
 {
-    if (g_uart_rx_buf_size < UART_RX_BUF_SIZE)
+    input_event_t ev;
+
+    ev.key = map_ascii_to_doom(byte);
+    if (!ev.key)
+        return;
+
+    ev.time = I_GetTimeUS();
+    ev.pressed = 1;
+    input_ring_push(&ev); // dropped if the ring is full
+}
+
+static void audio_timer_init(void)
+{
+    // APB1 timers run at twice PCLK1 when APB1 is divided
+    uint32_t timclock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+        timclock *= 2;
+
+    __HAL_RCC_TIM7_CLK_ENABLE();
+    htim7.Instance = TIM7;
+    htim7.Init.Prescaler = timclock / 1000000 - 1; // count microseconds
+    htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim7.Init.Period = AUDIO_TICK_US - 1;
+    htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    HAL_TIM_Base_Init(&htim7);
+
+    // Same priority as SysTick, so the mixer never interrupts I_UpdateTimer
+    // (and its I_GetTimeUS calls are safe), but above the game loop.
+    HAL_NVIC_SetPriority(TIM7_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM7_IRQn);
+    HAL_TIM_Base_Start_IT(&htim7);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance == TIM7)
     {
-        g_uart_rx_buf[g_uart_rx_buf_size] = byte;
-        g_uart_rx_buf_size++;
+        I_MixSoundTick(); // does nothing until the sound module is up
     }
 }
-
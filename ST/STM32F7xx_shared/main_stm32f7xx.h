@@ -38,3 +38,10 @@ void I_ErrorDisplay(const char* msg);
 
 void enable_dwt_cycle_counter(void);
 
+// Doom timer functions
+uint64_t I_GetTimeUS(void);
+void I_UpdateTimer(void);
+// Doom sound mixer, run from the audio timer interrupt
+void I_MixSoundTick(void);
+uint32_t I_GetVsync(uint64_t *time);
+
@@ -21,6 +21,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f7xx_hal.h"
 #include "stm32f7xx_it.h"
+#include "main_stm32f7xx.h"
 #ifdef STM32F769xx
 #include "stm32f769i_discovery.h"
 extern LTDC_HandleTypeDef hltdc_discovery;
@@ -47,6 +48,7 @@ static LTDC_HandleTypeDef* phltdc = &hLtdcHandler;
 extern SD_HandleTypeDef uSdHandle;
 extern UART_HandleTypeDef huart1;
 extern DMA2D_HandleTypeDef hdma2d;
+extern TIM_HandleTypeDef htim7;
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
@@ -154,6 +156,7 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   HAL_IncTick();
+  I_UpdateTimer(); // count DWT->CYCCNT wraps for I_GetTimeUS
 }
 
 /******************************************************************************/
@@ -232,6 +235,14 @@ void USART1_IRQHandler(void)
     HAL_UART_IRQHandler(&huart1);
 }
 
+/**
+ * @brief This function handles TIM7 global interrupt (sound mixer).
+ */
+void TIM7_IRQHandler(void)
+{
+    HAL_TIM_IRQHandler(&htim7);
+}
+
 /**
   * @}
   */
@@ -23,6 +23,7 @@
 
 #include "d_event.h"
 #include "d_loop.h"
+#include "d_pacer.h"
 #include "d_ticcmd.h"
 
 #include "i_system.h"
@@ -82,6 +83,20 @@ int gametic;
 
 boolean singletics = false;
 
+// If true, ticcmds are only built while waiting to run them, not
+// from the NetUpdate calls made while a frame is being drawn, so
+// that each one samples the input as late as possible.
+
+boolean latelatch = false;
+
+// True while TryRunTics is waiting for the tics it will run.
+
+static boolean buildingtics;
+
+// When the oldest input carried by each ticcmd was received.
+
+static uint64_t ticinputtime[BACKUPTICS];
+
 // Index of the local player.
 
 static int localplayer;
@@ -136,7 +151,23 @@ static int GetAdjustedTime(void)
         time_ms += (offsetms / FRACUNIT);
     }
 
-    return (time_ms * TICRATE) / 1000;
+    return (int) (((int64_t) time_ms * TICRATE) / 1000);
+}
+
+// I_GetTimeUS time at which GetAdjustedTime reaches tic
+
+static uint64_t AdjustedTicTime(int tic)
+{
+    int time_ms;
+
+    time_ms = (int) (((int64_t) tic * 1000 + TICRATE - 1) / TICRATE);
+
+    if (new_sync)
+    {
+        time_ms -= (offsetms / FRACUNIT);
+    }
+
+    return I_MSToTimeUS(time_ms);
 }
 
 static boolean BuildNewTic(void)
@@ -193,6 +224,7 @@ static boolean BuildNewTic(void)
 #endif
     ticdata[maketic % BACKUPTICS].cmds[localplayer] = cmd;
     ticdata[maketic % BACKUPTICS].ingame[localplayer] = true;
+    ticinputtime[maketic % BACKUPTICS] = D_PacerLatchInput(I_GetTimeUS());
 
     ++maketic;
 
@@ -218,6 +250,12 @@ void NetUpdate (void)
     if (singletics)
         return;
 
+    // Late latching: leave the time unread so the tics are built
+    // when TryRunTics next waits for them.
+
+    if (latelatch && !buildingtics && !net_client_connected)
+        return;
+
 #ifdef FEATURE_MULTIPLAYER
 
     // Run network subsystems
@@ -702,6 +740,13 @@ void TryRunTics (void)
     int realtics;
     int	availabletics;
     int	counts;
+    uint64_t vsynctime;
+    uint32_t vsynccount;
+
+    vsynccount = I_GetVsync(&vsynctime);
+    D_PacerVsync(vsynctime, vsynccount);
+
+    buildingtics = true;
 
     // get real tics
     entertic = I_GetTime() / ticdup;
@@ -770,13 +815,28 @@ void TryRunTics (void)
             // forever - give the menu a chance to work.
             if (I_GetTime() / ticdup - entertic >= MAX_NETGAME_STALL_TICS)
             {
+                buildingtics = false;
                 return;
             }
 
-            I_Sleep(1);
+            if (net_client_connected)
+            {
+                // keep polling for packets
+                I_Sleep(1);
+            }
+            else
+            {
+                // sleep until the next tic is built, or a little
+                // later to have its frame ready just before a vsync
+                I_SleepUS(D_PacerWakeTime(AdjustedTicTime((lasttime + 1) * ticdup)));
+            }
         }
     }
 
+    buildingtics = false;
+
+    D_PacerFrameStart(I_GetTimeUS());
+
     // run the count * ticdup dics
     while (counts--)
     {
@@ -788,6 +848,7 @@ void TryRunTics (void)
         }
 
         set = &ticdata[(gametic / ticdup) % BACKUPTICS];
+        D_PacerRunTic(ticinputtime[(gametic / ticdup) % BACKUPTICS]);
 
         if (!net_client_connected)
         {
@@ -0,0 +1,189 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Frame pacing against the display refresh.
+//
+//	A tic that is due does not have to run at once: its frame is
+//	only seen at the next vsync after it is drawn. The pacer puts
+//	off running the tic until the frame will be done just before
+//	that vsync, which shortens the time from the ticcmd being built
+//	to the frame being shown and makes that time the same from one
+//	frame to the next.
+//
+//	It also follows input events through ticcmds and frames to
+//	the vsync that shows them, to measure the input latency.
+//
+
+#include "d_pacer.h"
+
+// Time kept free between a frame being ready and its vsync.
+#define PACERMARGIN	1000
+
+// Frames slower than this are not worth pacing.
+#define MAXFRAMETIME	(1000000 / 35)
+
+static uint64_t	vsyncperiod;		// 0 until measured
+static uint64_t	vsynctime;
+static uint32_t	vsynccount;
+
+static uint64_t	frametime;		// estimate of run and draw time
+static uint64_t	framestart;
+static uint64_t	framedeadline;		// vsync the frame is aimed at
+
+int		pacerslack;
+
+static uint64_t	pendinginput;		// oldest input not in a ticcmd
+static uint64_t	frameinput;		// oldest input run since the last frame
+static uint64_t	presentinput;		// oldest input in a drawn frame
+static uint64_t	presentready;		// ... and when that frame was ready
+
+static uint64_t	ticcmdlatency;
+static int	ticcmdcount;
+static uint64_t	presentlatency;
+static int	presentcount;
+
+
+void D_PacerVsync (uint64_t time, uint32_t count)
+{
+    uint64_t	period;
+
+    if (count == vsynccount)
+	return;
+
+    // average over a few, they come with interrupt latency
+    if (vsynccount != 0 && time > vsynctime)
+    {
+	period = (time - vsynctime) / (count - vsynccount);
+
+	if (vsyncperiod == 0)
+	    vsyncperiod = period;
+	else
+	    vsyncperiod = (vsyncperiod * 7 + period) / 8;
+    }
+
+    vsynctime = time;
+    vsynccount = count;
+
+    // a drawn frame is presented at the first vsync after it is ready
+    if (presentinput != 0 && vsyncperiod != 0 && time >= presentready)
+    {
+	time -= (time - presentready) / vsyncperiod * vsyncperiod;
+
+	presentlatency += time - presentinput;
+	presentcount++;
+	presentinput = 0;
+    }
+}
+
+
+uint64_t D_PacerWakeTime (uint64_t ticdue)
+{
+    uint64_t	ready;
+    uint64_t	vsync;
+
+    // nothing to aim at yet
+    if (vsyncperiod == 0)
+    {
+	framedeadline = 0;
+	return ticdue;
+    }
+
+    // the first vsync the frame can make if run when due
+    ready = ticdue + frametime + PACERMARGIN;
+    vsync = vsynctime + vsyncperiod;
+
+    if (ready > vsync)
+	vsync += (ready - vsync + vsyncperiod - 1) / vsyncperiod * vsyncperiod;
+
+    framedeadline = vsync;
+
+    return vsync - frametime - PACERMARGIN;
+}
+
+
+void D_PacerFrameStart (uint64_t time)
+{
+    framestart = time;
+}
+
+
+void D_PacerFrameDone (uint64_t time)
+{
+    uint64_t	t;
+
+    t = time - framestart;
+
+    if (t > MAXFRAMETIME)
+	t = MAXFRAMETIME;
+
+    // Rise at once and fall over several seconds, so the estimate
+    // sits near the slowest recent frame and vsyncs are not missed.
+    if (t > frametime)
+	frametime = t;
+    else
+	frametime -= (frametime - t) / 256;
+
+    if (framedeadline != 0)
+	pacerslack = (int) ((int64_t) framedeadline - (int64_t) time);
+
+    if (frameinput != 0)
+    {
+	presentinput = frameinput;
+	presentready = time;
+	frameinput = 0;
+    }
+}
+
+
+void D_PacerInput (uint64_t time)
+{
+    if (pendinginput == 0 || time < pendinginput)
+	pendinginput = time;
+}
+
+
+uint64_t D_PacerLatchInput (uint64_t time)
+{
+    uint64_t	input;
+
+    input = pendinginput;
+    pendinginput = 0;
+
+    if (input != 0)
+    {
+	ticcmdlatency += time - input;
+	ticcmdcount++;
+    }
+
+    return input;
+}
+
+
+void D_PacerRunTic (uint64_t inputtime)
+{
+    if (inputtime != 0 && (frameinput == 0 || inputtime < frameinput))
+	frameinput = inputtime;
+}
+
+
+void D_PacerLatency (int *ticcmd, int *present)
+{
+    *ticcmd = ticcmdcount ? (int) (ticcmdlatency / ticcmdcount) : 0;
+    *present = presentcount ? (int) (presentlatency / presentcount) : 0;
+
+    ticcmdlatency = presentlatency = 0;
+    ticcmdcount = presentcount = 0;
+}
+
@@ -0,0 +1,61 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Frame pacing against the display refresh.
+//
+
+#ifndef __D_PACER__
+#define __D_PACER__
+
+#include "doomtype.h"
+
+// All times are I_GetTimeUS microseconds. The pacer only does
+// arithmetic on the times it is given, so it runs the same on a
+// simulated clock.
+
+// Report the latest vsync and the number of vsyncs so far.
+void D_PacerVsync (uint64_t time, uint32_t count);
+
+// Returns when to wake up to run a tic that is due at ticdue,
+// so that its frame is ready just before a vsync.
+uint64_t D_PacerWakeTime (uint64_t ticdue);
+
+// Bracket the running and drawing of a frame.
+void D_PacerFrameStart (uint64_t time);
+void D_PacerFrameDone (uint64_t time);
+
+// How long before its vsync the last frame was ready
+// (negative if it missed it), in microseconds.
+extern int pacerslack;
+
+// Input latency. An input event received at some time is carried
+// by the next ticcmd built, then by the frame drawn after that tic
+// is run, and is seen when the frame is presented.
+
+void D_PacerInput (uint64_t time);
+
+// A ticcmd is being built at time; returns when the oldest input
+// it carries was received, or 0 for none.
+uint64_t D_PacerLatchInput (uint64_t time);
+
+// A tic carrying input received at inputtime (or 0) is run.
+void D_PacerRunTic (uint64_t inputtime);
+
+// Average input to ticcmd and input to present times since the
+// last call, in microseconds (0 if there was no input).
+void D_PacerLatency (int *ticcmd, int *present);
+
+#endif
+
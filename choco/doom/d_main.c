@@ -242,7 +242,16 @@ void D_Display (void)
     
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
+    // turn the view by the newest input
+    if (latelatch)
+    {
+        I_StartTic ();
+        D_ProcessEvents ();
+    }
+    latchedturn = G_LatchedTurn ();
     R_RenderPlayerView (&players[displayplayer]);
+    }
 
     if (gamestate == GS_LEVEL && gametic)
     HU_Drawer ();
@@ -475,6 +484,9 @@ void doom_tick(void)
     // Update display, next frame, with current state.
     if (screenvisible)
         D_Display ();
+
+    // write out recorded demo chunks between frames
+    G_UpdateDemoStream ();
 }
 
 //
@@ -1189,6 +1201,8 @@ static void G_CheckDemoStatusAtExit (void)
 void D_DoomMain (void)
 {
     int p;
+    int boottime;
+    int starttime;
     char file[256];
     char demolumpname[9];
     // int numiwadlumps;
@@ -1199,6 +1213,8 @@ void D_DoomMain (void)
 
     I_PrintBanner(PACKAGE_STRING);
 
+    boottime = I_GetTimeMS();
+
     printf("Z_Init: Init zone memory allocation daemon. \n");
     Z_Init ();
 
@@ -1285,6 +1301,15 @@ void D_DoomMain (void)
 
     fastparm = M_CheckParm ("-fast");
 
+    //!
+    // @category game
+    //
+    // Quicksave and quickload keep a single snapshot in RAM
+    // instead of using a savegame slot.
+    //
+
+    ramsave = M_ParmExists("-ramsave");
+
     //! 
     // @vanilla
     //
@@ -1294,6 +1319,15 @@ void D_DoomMain (void)
 
     devparm = M_CheckParm ("-devparm");
 
+    //!
+    // @category game
+    //
+    // Build each tic's command just before it is run, and turn
+    // the view by the newest input when a frame is drawn.
+    //
+
+    latelatch = M_ParmExists("-latelatch");
+
     I_DisplayFPSDots(devparm);
 
     //!
@@ -1400,6 +1434,7 @@ void D_DoomMain (void)
     modifiedgame = false;
 
     printf("W_Init: Init WADfiles.\n");
+    starttime = I_GetTimeMS();
     D_AddFile(iwadfile);
     // numiwadlumps = numlumps;
 
@@ -1539,10 +1574,60 @@ void D_DoomMain (void)
         printf("Playing demo %s.\n", file);
     }
 
+    //!
+    // @arg <demo[:hash]> ...
+    // @category demo
+    //
+    // Play back each demo in turn with no drawing, reporting tics
+    // per second and a hash of the game state for every demo.
+    // If a hash is given after a colon, a different result is
+    // reported as a desync and the run ends with an error.
+    //
+
+    p = M_CheckParmWithArgs("-simdemos", 1);
+
+    if (p)
+    {
+        char name[256];
+        char *hash;
+        int i;
+
+        for (i = p + 1; i < myargc && myargv[i][0] != '-'; i++)
+        {
+            M_StringCopy(name, myargv[i], sizeof(name));
+            hash = strchr(name, ':');
+
+            if (hash != NULL)
+            {
+                *hash++ = '\0';
+            }
+
+            if (M_StringEndsWith(name, ".lmp") || M_StringEndsWith(name, ".LMP"))
+            {
+                M_StringCopy(file, name, sizeof(file));
+            }
+            else
+            {
+                snprintf(file, sizeof(file), "%s.lmp", name);
+            }
+
+            if (D_AddFile(file))
+            {
+                G_AddSimDemo(lumpinfo[numlumps - 1].name, hash);
+            }
+            else
+            {
+                G_AddSimDemo(name, hash);
+            }
+        }
+
+        printf("Simulating %i demos.\n", i - p - 1);
+    }
+
     I_AtExit(G_CheckDemoStatusAtExit, true);
 
-    // Generate the WAD hash table.  Speed things up a bit.
-    W_GenerateHashTable();
+    // The WAD hash table is kept up to date by W_AddFile.
+    printf("W_Init: %i lumps in %i ms.\n", numlumps, I_GetTimeMS() - starttime);
 
     // Load DEHACKED lumps from WAD files - but only if we give the right
     // command line parameter.
@@ -1790,10 +1875,17 @@ void D_DoomMain (void)
     M_Init ();
 
     printf("R_Init: Init DOOM refresh daemon - ");
+    starttime = I_GetTimeMS();
     R_Init ();
+    printf(" %i ms, zone %u KB", I_GetTimeMS() - starttime,
+           (unsigned int) (Z_ZoneUsage() / 1024));
 
     printf("\nP_Init: Init Playloop state.\n");
+    starttime = I_GetTimeMS();
     P_Init ();
+    printf("P_Init: %i sprites in %i ms.\n", numsprites, I_GetTimeMS() - starttime);
+
+    R_SaveStartupCache ();
 
     printf("S_Init: Setting up sound.\n");
     S_Init (sfxVolume * 8, musicVolume * 8);
@@ -1809,6 +1901,9 @@ void D_DoomMain (void)
     printf("ST_Init: Init status bar.\n");
     ST_Init ();
 
+    printf("D_DoomMain: %s boot in %i ms.\n",
+           startupcacheloaded ? "warm" : "cold", I_GetTimeMS() - boottime);
+
     // If Doom II without a MAP01 lump, this is a store demo.
     // Moved this here so that MAP01 isn't constantly looked up
     // in the main loop.
@@ -1838,6 +1933,28 @@ void D_DoomMain (void)
     autostart = true;
     }
 
+    //!
+    // @arg <tics>
+    // @category demo
+    //
+    // Keep a keyframe every <tics> tics during demo playback, so
+    // the left and right arrow keys can rewind and skip the demo.
+    //
+
+    p = M_CheckParmWithArgs("-demokeyframes", 1);
+
+    if (p)
+    {
+    G_DemoKeyframes (atoi(myargv[p+1]));
+    }
+
+    if (M_CheckParmWithArgs("-simdemos", 1))
+    {
+    G_SimDemos ();
+    D_DoomLoop ();
+    return;
+    }
+
     p = M_CheckParmWithArgs("-playdemo", 1);
     if (p)
     {
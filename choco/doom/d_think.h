@@ -60,6 +60,12 @@ typedef struct thinker_s
     struct thinker_s*	prev;
     struct thinker_s*	next;
     think_t		function;
+
+    // Links in the subset of the list that P_RunThinkers
+    // visits, kept in the same relative order.
+    // anext is NULL while the thinker sleeps.
+    struct thinker_s*	aprev;
+    struct thinker_s*	anext;
     
 } thinker_t;
 
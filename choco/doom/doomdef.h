@@ -66,7 +66,10 @@ typedef enum
     ga_completed,
     ga_victory,
     ga_worlddone,
-    ga_screenshot
+    ga_screenshot,
+    ga_savesnapshot,
+    ga_loadsnapshot,
+    ga_seekdemo
 } gameaction_t;
 
 //
@@ -148,6 +148,7 @@ extern  boolean	paused;		// Game Pause?
 extern  boolean		viewactive;
 
 extern  boolean		nodrawers;
+extern  boolean		timingdemo;
 
 
 extern  boolean         testcontrols;
@@ -160,6 +161,9 @@ extern  int             testcontrols_mousespeed;
 // ANG90 = left side, ANG270 = right
 extern  int	viewangleoffset;
 
+// Turn from input newer than the last tic (-latelatch).
+extern  int	latchedturn;
+
 // Player taking events, and displaying.
 extern  int	consoleplayer;	
 extern  int	displayplayer;
@@ -274,6 +278,7 @@ extern int		skyflatnum;
 
 
 extern	int		rndindex;
+extern	int		prndindex;
 
 extern  ticcmd_t       *netcmds;
 
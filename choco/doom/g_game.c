@@ -90,6 +90,15 @@ void	G_DoCompleted (void);
 void	G_DoVictory (void); 
 void	G_DoWorldDone (void); 
 void	G_DoSaveGame (void); 
+void	G_DoSaveSnapshot (void); 
+void	G_DoLoadSnapshot (void); 
+void	G_DoSeekDemo (void); 
+
+static void G_SimDemoHashTic (void);
+static void G_DemoKeyframeTic (void);
+static void G_ResetDemoKeyframes (void);
+static boolean G_DemoKeyframeResponder (event_t* ev);
+static void G_SetSkyTexture (void);
  
 // Gamestate the last time G_Ticker was called.
 
@@ -110,6 +119,7 @@ boolean         paused;
 boolean         sendpause;             	// send a pause event next tic 
 boolean         sendsave;             	// send a save event next tic 
 boolean         usergame;               // ok to save / end game 
+boolean         ramsave;                // quicksave to a RAM snapshot 
  
 boolean         timingdemo;             // if true, exit with report on completion 
 boolean         nodrawers;              // for comparative timing purposes 
@@ -127,6 +137,7 @@ boolean         turbodetected[MAXPLAYERS];
 int             consoleplayer;          // player taking events and displaying 
 int             displayplayer;          // view being displayed 
 int             levelstarttic;          // gametic at level start 
+static int      levelsetuprandom;       // P_Random calls made by P_SetupLevel
 int             totalkills, totalitems, totalsecret;    // for intermission 
  
 char           *demoname;
@@ -138,6 +149,7 @@ boolean		netdemo;
 byte*		demobuffer;
 byte*		demo_p;
 byte*		demoend; 
+static int	demotic;		// tics of the demo played
 boolean         singledemo;            	// quit after playing a demo from cmdline 
  
 boolean         precache = true;        // if true, load all graphics at start 
@@ -199,6 +211,7 @@ static const struct
 
 static boolean  gamekeydown[NUMKEYS]; 
 static int      turnheld;		// for accelerative turning 
+static uint64_t ticcmdtime;		// when the last ticcmd was built
  
 static boolean  mousearray[MAX_MOUSE_BUTTONS + 1];
 static boolean *mousebuttons = &mousearray[1];  // allow [-1]
@@ -332,6 +345,7 @@ void G_BuildTiccmd (ticcmd_t* cmd, int maketic)
     int		side;
 
     memset(cmd, 0, sizeof(ticcmd_t));
+    ticcmdtime = I_GetTimeUS();
 
     cmd->consistancy = 
 	consistancy[consoleplayer][maketic%BACKUPTICS]; 
@@ -597,6 +611,55 @@ void G_BuildTiccmd (ticcmd_t* cmd, int maketic)
         carry = desired_angleturn - cmd->angleturn;
     }
 } 
+
+
+//
+// G_LatchedTurn
+// With -latelatch, the part of the next ticcmd's turn that the
+// keys held now would have made since the last ticcmd was built.
+// Added to the view angle only; the player is not moved.
+//
+int G_LatchedTurn (void)
+{
+    int		tspeed;
+    int		turn;
+    int64_t	elapsed;
+
+    if (!latelatch
+     || gamestate != GS_LEVEL
+     || demoplayback
+     || paused
+     || menuactive
+     || automapactive
+     || displayplayer != consoleplayer)
+	return 0;
+
+    if (gamekeydown[key_strafe] || mousebuttons[mousebstrafe]
+     || joybuttons[joybstrafe])
+	return 0;
+
+    if (turnheld + ticdup < SLOWTURNTICS)
+	tspeed = 2;
+    else if (key_speed >= NUMKEYS
+          || joybspeed >= MAX_JOY_BUTTONS
+          || gamekeydown[key_speed]
+          || joybuttons[joybspeed])
+	tspeed = 1;
+    else
+	tspeed = 0;
+
+    turn = 0;
+    if (gamekeydown[key_right] || joyxmove > 0)
+	turn -= angleturn[tspeed];
+    if (gamekeydown[key_left] || joyxmove < 0)
+	turn += angleturn[tspeed];
+
+    elapsed = I_GetTimeUS() - ticcmdtime;
+    if (elapsed > 1000000 / TICRATE)
+	elapsed = 1000000 / TICRATE;
+
+    return (int) (((int64_t) turn << 16) * elapsed * TICRATE / 1000000);
+}
  
 
 //
@@ -653,7 +716,9 @@ void G_DoLoadLevel (void)
 	memset (players[i].frags,0,sizeof(players[i].frags)); 
     } 
 		 
+    i = prndindex;
     P_SetupLevel (gameepisode, gamemap, 0, gameskill);    
+    levelsetuprandom = (prndindex - i) & 0xff;
     displayplayer = consoleplayer;		// view the guy you are playing    
     gameaction = ga_nothing; 
     Z_CheckHeap ();
@@ -747,6 +812,10 @@ boolean G_Responder (event_t* ev)
 	return true; 
     }
     
+    // rewind and skip through a demo with keyframes
+    if (demoplayback && G_DemoKeyframeResponder (ev))
+	return true;
+
     // any other key pops up menu if in demos
     if (gameaction == ga_nothing && !singledemo && 
 	(demoplayback || gamestate == GS_DEMOSCREEN) 
@@ -897,6 +966,15 @@ void G_Ticker (void)
             players[consoleplayer].message = "screen shot";
 	    gameaction = ga_nothing; 
 	    break; 
+	  case ga_savesnapshot: 
+	    G_DoSaveSnapshot (); 
+	    break; 
+	  case ga_loadsnapshot: 
+	    G_DoLoadSnapshot (); 
+	    break; 
+	  case ga_seekdemo: 
+	    G_DoSeekDemo (); 
+	    break; 
 	  case ga_nothing: 
 	    break; 
 	} 
@@ -959,6 +1037,9 @@ void G_Ticker (void)
 	    } 
 	}
     }
+
+    if (demoplayback)
+	demotic++;
     
     // check for special buttons
     for (i=0 ; i<MAXPLAYERS ; i++)
@@ -1024,6 +1105,12 @@ void G_Ticker (void)
 	D_PageTicker (); 
 	break;
     }        
+
+    if (demoplayback)
+    {
+	G_SimDemoHashTic ();
+	G_DemoKeyframeTic ();
+    }
 } 
  
  
@@ -1546,31 +1633,108 @@ void G_LoadGame (char* name)
 #define VERSIONSIZE		16 
 
 
-void G_DoLoadGame (void) 
-{ 
-    int savedleveltime;
-	 
-    gameaction = ga_nothing; 
-	 
-    save_stream = fopen(savename, "rb");
+//
+// G_ResetLevel
+// Brings the level that is already loaded back to the state
+// G_InitNew leaves it in, minus the things and specials that
+// P_UnArchiveThinkers throws away anyway, so that a savegame for
+// the same map and skill can be unarchived over it without
+// reading the map lumps again.
+//
+static void G_ResetLevel (void)
+{
+    int		i;
 
-    if (save_stream == NULL)
+    if (paused)
     {
-        return;
+	paused = false;
+	S_ResumeSound ();
     }
 
+    // The random index after a load is whatever P_SetupLevel
+    // left it at, starting from M_ClearRandom in G_InitNew.
+    M_ClearRandom ();
+    prndindex = levelsetuprandom;
+
+    automapactive = false;
+    viewactive = true;
+
+    // The Final Doom sky is picked per map by G_DoLoadLevel.
+    if (!(gamemode == commercial && gameversion == exe_final2))
+	G_SetSkyTexture ();
+
+    levelstarttic = gametic;
+    gamestate = GS_LEVEL;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	turbodetected[i] = false;
+
+    displayplayer = consoleplayer;
+
+    memset (gamekeydown, 0, sizeof(gamekeydown));
+    joyxmove = joyymove = joystrafemove = 0;
+    mousex = mousey = 0;
+    sendpause = sendsave = paused = false;
+    memset(mousearray, 0, sizeof(mousearray));
+    memset(joyarray, 0, sizeof(joyarray));
+
+    // From P_SetupLevel.
+    S_Start ();
+    bodyqueslot = 0;
+    iquehead = iquetail = 0;
+    P_ClearSpecials ();
+    P_ClearSightCache ();
+
+    // From P_SpawnPlayer.
+    ST_Start ();
+    HU_Start ();
+}
+
+
+//
+// G_UnArchiveGame
+// Restores the game from save_buffer. Returns false if the header
+// does not match this version.
+//
+static boolean G_UnArchiveGame (void)
+{
+    skill_t	skill;
+    int		episode;
+    int		map;
+    boolean	ingame[MAXPLAYERS];
+    boolean	samelevel;
+    int		savedleveltime;
+    int		i;
+
+    skill = gameskill;
+    episode = gameepisode;
+    map = gamemap;
+    memcpy (ingame, playeringame, sizeof(ingame));
+
     savegame_error = false;
+    save_offset = 0;
 
     if (!P_ReadSaveGameHeader())
-    {
-        fclose(save_stream);
-        return;
-    }
+	return false;
+
+    // a keyframe is restored into the demo that is playing
+    samelevel = gamestate == GS_LEVEL
+	     && (savegame_exact || (usergame && !demoplayback && !netgame))
+	     && skill == gameskill
+	     && episode == gameepisode
+	     && map == gamemap;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	if (ingame[i] != playeringame[i])
+	    samelevel = false;
 
     savedleveltime = leveltime;
     
     // load a base level 
-    G_InitNew (gameskill, gameepisode, gamemap); 
+    if (samelevel)
+	G_ResetLevel ();
+    else
+	G_InitNew (gameskill, gameepisode, gamemap); 
  
     leveltime = savedleveltime;
 
@@ -1579,17 +1743,84 @@ void G_DoLoadGame (void)
     P_UnArchiveWorld (); 
     P_UnArchiveThinkers (); 
     P_UnArchiveSpecials (); 
+
+    // tags and teleport destinations came back with the world
+    P_InitTagLists ();
  
     if (!P_ReadSaveGameEOF())
 	I_Error ("Bad savegame");
 
-    fclose(save_stream);
-    
     if (setsizeneeded)
 	R_ExecuteSetViewSize ();
     
     // draw the pattern into the back screen
     R_FillBackScreen ();   
+
+    return true;
+}
+
+
+//
+// G_ArchiveGame
+// Writes the game into save_buffer, from the start.
+//
+static void G_ArchiveGame (char* description)
+{
+    savegame_error = false;
+    save_offset = 0;
+
+    P_WriteSaveGameHeader(description);
+ 
+    P_ArchivePlayers (); 
+    P_ArchiveWorld (); 
+    P_ArchiveThinkers (); 
+    P_ArchiveSpecials (); 
+	 
+    P_WriteSaveGameEOF();
+}
+
+
+void G_DoLoadGame (void) 
+{ 
+    FILE*	handle;
+    int		length;
+	 
+    gameaction = ga_nothing; 
+	 
+    handle = fopen(savename, "rb");
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    // Read the whole file in one go and restore from memory.
+
+    length = M_FileLength(handle);
+
+    if (length <= 0)
+    {
+        fclose(handle);
+        return;
+    }
+
+    save_buffer = Z_Malloc (length, PU_STATIC, NULL);
+    save_buffer_size = length;
+
+    if (fread(save_buffer, 1, length, handle) < length)
+    {
+        length = 0;
+    }
+
+    fclose(handle);
+
+    if (length > 0)
+    {
+        G_UnArchiveGame ();
+    }
+
+    Z_Free (save_buffer);
+    save_buffer = NULL;
 } 
  
 
@@ -1612,50 +1843,62 @@ void G_DoSaveGame (void)
 { 
     char *savegame_file;
     char *temp_savegame_file;
+    FILE *handle;
+    int length;
 
     temp_savegame_file = P_TempSaveGameFile();
     savegame_file = P_SaveGameFile(savegameslot);
 
+    // Build the savegame in memory, then write it out in one go.
+
+    save_buffer = Z_Malloc (SAVEGAMESIZE, PU_STATIC, NULL);
+    save_buffer_size = SAVEGAMESIZE;
+
+    G_ArchiveGame (savedescription);
+    length = save_offset;
+
+    // Enforce the same savegame size limit as in Vanilla Doom, 
+    // except if the vanilla_savegame_limit setting is turned off.
+
+    if (vanilla_savegame_limit && length > SAVEGAMESIZE)
+    {
+        I_Error ("Savegame buffer overrun");
+    }
+
     // Open the savegame file for writing.  We write to a temporary file
     // and then rename it at the end if it was successfully written.
     // This prevents an existing savegame from being overwritten by 
     // a corrupted one, or if a savegame buffer overrun occurs.
 
-    save_stream = fopen(temp_savegame_file, "wb");
+    handle = fopen(temp_savegame_file, "wb");
 
-    if (save_stream == NULL)
+    if (handle == NULL)
     {
+        Z_Free (save_buffer);
+        save_buffer = NULL;
         return;
     }
 
-    savegame_error = false;
-
-    P_WriteSaveGameHeader(savedescription);
- 
-    P_ArchivePlayers (); 
-    P_ArchiveWorld (); 
-    P_ArchiveThinkers (); 
-    P_ArchiveSpecials (); 
-	 
-    P_WriteSaveGameEOF();
-	 
-    // Enforce the same savegame size limit as in Vanilla Doom, 
-    // except if the vanilla_savegame_limit setting is turned off.
-
-    if (vanilla_savegame_limit && ftell(save_stream) > SAVEGAMESIZE)
+    if (fwrite(save_buffer, 1, length, handle) < length)
     {
-        I_Error ("Savegame buffer overrun");
+        fprintf(stderr, "G_DoSaveGame: Error while writing save game\n");
+        savegame_error = true;
     }
-    
+
     // Finish up, close the savegame file.
 
-    fclose(save_stream);
+    fclose(handle);
+    Z_Free (save_buffer);
+    save_buffer = NULL;
 
     // Now rename the temporary savegame file to the actual savegame
     // file, overwriting the old savegame if there was one there.
 
-    remove(savegame_file);
-    rename(temp_savegame_file, savegame_file);
+    if (!savegame_error)
+    {
+        remove(savegame_file);
+        rename(temp_savegame_file, savegame_file);
+    }
     
     gameaction = ga_nothing; 
     M_StringCopy(savedescription, "", sizeof(savedescription));
@@ -1665,7 +1908,120 @@ void G_DoSaveGame (void)
     // draw the pattern into the back screen
     R_FillBackScreen ();	
 } 
- 
+
+
+//
+// G_SaveSnapshot, G_LoadSnapshot
+// Quicksave and quickload to RAM (-ramsave). The snapshot uses
+// the savegame format and stays in a zone buffer that is kept
+// between saves.
+//
+static byte*	snapshot;
+static int	snapshotsize;
+static int	snapshotlength;
+
+void G_SaveSnapshot (void)
+{
+    gameaction = ga_savesnapshot;
+}
+
+void G_LoadSnapshot (void)
+{
+    if (snapshotlength > 0)
+	gameaction = ga_loadsnapshot;
+}
+
+void G_DoSaveSnapshot (void)
+{
+    int		starttime;
+
+    gameaction = ga_nothing;
+    starttime = I_GetTimeMS ();
+
+    if (snapshot == NULL)
+    {
+	snapshotsize = SAVEGAMESIZE;
+	snapshot = Z_Malloc (snapshotsize, PU_STATIC, NULL);
+    }
+
+    save_buffer = snapshot;
+    save_buffer_size = snapshotsize;
+
+    G_ArchiveGame ("SNAPSHOT");
+
+    // the buffer may have been grown
+    snapshot = save_buffer;
+    snapshotsize = save_buffer_size;
+    snapshotlength = save_offset;
+    save_buffer = NULL;
+
+    printf ("G_DoSaveSnapshot: %i bytes in %i ms\n",
+	    snapshotlength, I_GetTimeMS () - starttime);
+
+    players[consoleplayer].message = GGSAVED;
+}
+
+void G_DoLoadSnapshot (void)
+{
+    int		starttime;
+
+    gameaction = ga_nothing;
+    starttime = I_GetTimeMS ();
+
+    save_buffer = snapshot;
+    save_buffer_size = snapshotlength;
+
+    G_UnArchiveGame ();
+
+    save_buffer = NULL;
+
+    printf ("G_DoLoadSnapshot: %i bytes in %i ms\n",
+	    snapshotlength, I_GetTimeMS () - starttime);
+}
+
+
+//
+// G_SetSkyTexture
+// Picks the sky for the current episode and map.
+//
+static void G_SetSkyTexture (void)
+{
+    char *skytexturename;
+
+    if (gamemode == commercial)
+    {
+        if (gamemap < 12)
+            skytexturename = "SKY1";
+        else if (gamemap < 21)
+            skytexturename = "SKY2";
+        else
+            skytexturename = "SKY3";
+    }
+    else
+    {
+        switch (gameepisode)
+        {
+          default:
+          case 1:
+            skytexturename = "SKY1";
+            break;
+          case 2:
+            skytexturename = "SKY2";
+            break;
+          case 3:
+            skytexturename = "SKY3";
+            break;
+          case 4:        // Special Edition sky
+            skytexturename = "SKY4";
+            break;
+        }
+    }
+
+    // skytexturename = DEH_String(skytexturename);
+
+    skytexture = R_TextureNumForName(skytexturename);
+}
+
 
 //
 // G_InitNew
@@ -1711,7 +2067,6 @@ G_InitNew
   int		episode,
   int		map )
 {
-    char *skytexturename;
     int             i;
 
     if (paused)
@@ -1809,39 +2164,7 @@ G_InitNew
     // restore from a saved game.  This was fixed before the Doom
     // source release, but this IS the way Vanilla DOS Doom behaves.
 
-    if (gamemode == commercial)
-    {
-        if (gamemap < 12)
-            skytexturename = "SKY1";
-        else if (gamemap < 21)
-            skytexturename = "SKY2";
-        else
-            skytexturename = "SKY3";
-    }
-    else
-    {
-        switch (gameepisode)
-        {
-          default:
-          case 1:
-            skytexturename = "SKY1";
-            break;
-          case 2:
-            skytexturename = "SKY2";
-            break;
-          case 3:
-            skytexturename = "SKY3";
-            break;
-          case 4:        // Special Edition sky
-            skytexturename = "SKY4";
-            break;
-        }
-    }
-
-    // skytexturename = DEH_String(skytexturename);
-
-    skytexture = R_TextureNumForName(skytexturename);
-
+    G_SetSkyTexture ();
 
     G_DoLoadLevel ();
 }
@@ -1881,34 +2204,83 @@ void G_ReadDemoTiccmd (ticcmd_t* cmd)
 
 // Increase the size of the demo buffer to allow unlimited demos
 
-static void IncreaseDemoBuffer(void)
+//
+// Streaming demo recording, used when vanilla_demo_limit is off.
+// Tics are recorded into one of two chunk buffers. When it is
+// full, it is queued for writing and recording carries on in the
+// other one, while G_UpdateDemoStream writes the queued chunk out
+// a sector at a time between frames. Memory use stays the same
+// however long the demo gets.
+//
+#define DEMOCHUNKSIZE	4096
+#define DEMOWRITESIZE	512
+
+static FILE*	demostream;
+static byte*	demochunks[2];
+static int	demochunk;		// chunk being recorded into
+static byte*	demoflush_p;		// next queued byte to write
+static byte*	demoflushend;
+
+static void G_WriteDemoStream (int count)
 {
-    int current_length;
-    byte *new_demobuffer;
-    byte *new_demop;
-    int new_length;
+    if (fwrite(demoflush_p, 1, count, demostream) < count)
+	I_Error ("Error writing demo %s", demoname);
 
-    // Find the current size
+    demoflush_p += count;
+}
 
-    current_length = demoend - demobuffer;
-    
-    // Generate a new buffer twice the size
-    new_length = current_length * 2;
-    
-    new_demobuffer = Z_Malloc(new_length, PU_STATIC, 0);
-    new_demop = new_demobuffer + (demo_p - demobuffer);
+//
+// G_UpdateDemoStream
+// Writes part of the queued chunk, if there is one.
+// Called once per frame.
+//
+void G_UpdateDemoStream (void)
+{
+    int		count;
 
-    // Copy over the old data
+    if (demoflush_p == demoflushend)
+	return;
 
-    memcpy(new_demobuffer, demobuffer, current_length);
+    count = demoflushend - demoflush_p;
+    if (count > DEMOWRITESIZE)
+	count = DEMOWRITESIZE;
 
-    // Free the old buffer and point the demo pointers at the new buffer.
+    G_WriteDemoStream (count);
+}
 
-    Z_Free(demobuffer);
+//
+// G_QueueDemoChunk
+// Hands the full chunk to the writer and starts on the other one,
+// which is first written out completely if the writer has not
+// finished with it yet.
+//
+static void G_QueueDemoChunk (void)
+{
+    if (demoflush_p != demoflushend)
+	G_WriteDemoStream (demoflushend - demoflush_p);
+
+    demoflush_p = demobuffer;
+    demoflushend = demo_p;
 
-    demobuffer = new_demobuffer;
-    demo_p = new_demop;
-    demoend = demobuffer + new_length;
+    demochunk ^= 1;
+    demobuffer = demo_p = demochunks[demochunk];
+    demoend = demobuffer + DEMOCHUNKSIZE + 16;
+}
+
+//
+// G_FinishDemoStream
+// Writes out everything recorded and closes the demo file.
+//
+static void G_FinishDemoStream (void)
+{
+    G_QueueDemoChunk ();
+    G_WriteDemoStream (demoflushend - demoflush_p);
+
+    fclose (demostream);
+    demostream = NULL;
+
+    Z_Free (demochunks[0]);
+    Z_Free (demochunks[1]);
 }
 
 void G_WriteDemoTiccmd (ticcmd_t* cmd) 
@@ -1918,6 +2290,9 @@ void G_WriteDemoTiccmd (ticcmd_t* cmd)
     if (gamekeydown[key_demo_quit])           // press q to end demo recording 
 	G_CheckDemoStatus (); 
 
+    if (demostream != NULL && demo_p - demobuffer >= DEMOCHUNKSIZE)
+	G_QueueDemoChunk ();
+
     demo_start = demo_p;
 
     *demo_p++ = cmd->forwardmove; 
@@ -1940,21 +2315,13 @@ void G_WriteDemoTiccmd (ticcmd_t* cmd)
     // reset demo pointer back
     demo_p = demo_start;
 
+    // Only reached with the vanilla demo limit; without it the
+    // demo is streamed and never runs out of space.
     if (demo_p > demoend - 16)
     {
-        if (vanilla_demo_limit)
-        {
-            // no more space 
-            G_CheckDemoStatus (); 
-            return; 
-        }
-        else
-        {
-            // Vanilla demo limit disabled: unlimited
-            // demo lengths!
-
-            IncreaseDemoBuffer();
-        }
+        // no more space 
+        G_CheckDemoStatus (); 
+        return; 
     } 
 	
     G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same 
@@ -1988,8 +2355,30 @@ void G_RecordDemo (char *name)
     i = M_CheckParmWithArgs("-maxdemo", 1);
     if (i)
 	maxsize = atoi(myargv[i+1])*1024;
-    demobuffer = Z_Malloc (maxsize,PU_STATIC,NULL); 
-    demoend = demobuffer + maxsize;
+
+    if (!vanilla_demo_limit)
+    {
+	// Vanilla demo limit disabled: unlimited demo lengths,
+	// streamed to the file as they are recorded.
+
+	demostream = fopen(demoname, "wb");
+
+	if (demostream == NULL)
+	    I_Error ("Couldn't open demo %s", demoname);
+
+	demochunks[0] = Z_Malloc (DEMOCHUNKSIZE + 16, PU_STATIC, NULL);
+	demochunks[1] = Z_Malloc (DEMOCHUNKSIZE + 16, PU_STATIC, NULL);
+	demochunk = 0;
+	demoflush_p = demoflushend = NULL;
+
+	demobuffer = demochunks[0];
+	demoend = demobuffer + DEMOCHUNKSIZE + 16;
+    }
+    else
+    {
+	demobuffer = Z_Malloc (maxsize,PU_STATIC,NULL); 
+	demoend = demobuffer + maxsize;
+    }
 	
     demorecording = true; 
 } 
@@ -2056,6 +2445,519 @@ void G_BeginRecording (void)
 } 
  
 
+//
+// Headless batch playback (-simdemos).
+// Each demo runs with no drawing and one tic per loop, and
+// gets a hash of the game state folded in every tic.
+//
+#define MAXSIMDEMOS	32
+
+typedef struct
+{
+    char		name[9];
+    boolean		checked;	// an expected hash was given
+    unsigned int	expected;
+} simdemo_t;
+
+static simdemo_t	simdemos[MAXSIMDEMOS];
+static int		numsimdemos;
+static int		simdemo;		// index being played
+static int		simdemodesyncs;
+static int		simdemostarttic;
+static int		simdemostartms;
+static int		simdemototaltics;
+static int		simdemototalms;
+static unsigned int	simdemohash;
+
+void G_AddSimDemo (char* name, char* expected)
+{
+    simdemo_t*	sd;
+
+    if (numsimdemos == MAXSIMDEMOS)
+	I_Error ("G_AddSimDemo: more than %i demos", MAXSIMDEMOS);
+
+    sd = &simdemos[numsimdemos++];
+    M_StringCopy (sd->name, name, sizeof(sd->name));
+    sd->checked = expected != NULL;
+    sd->expected = expected ? strtoul (expected, NULL, 16) : 0;
+}
+
+//
+// G_SimDemoHashTic
+// Folds the RNG position and every player's body into the hash,
+// so a desync shows up even if the demo later converges again.
+//
+static void G_SimDemoHashTic (void)
+{
+    int		i;
+    mobj_t*	mo;
+    unsigned int h;
+
+    if (!numsimdemos)
+	return;
+
+    h = simdemohash * 31 + prndindex;
+    h = h * 31 + leveltime;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	if (!playeringame[i] || !players[i].mo)
+	    continue;
+
+	mo = players[i].mo;
+	h = h * 31 + mo->x;
+	h = h * 31 + mo->y;
+	h = h * 31 + mo->z;
+	h = h * 31 + mo->angle;
+	h = h * 31 + mo->health;
+    }
+
+    simdemohash = h;
+}
+
+//
+// G_SimDemoDone
+// Reports the demo that just ended and starts the next one.
+//
+static void G_SimDemoDone (void)
+{
+    simdemo_t*	sd;
+    int		tics;
+    int		ms;
+
+    sd = &simdemos[simdemo];
+    tics = gametic - simdemostarttic;
+    ms = I_GetTimeMS () - simdemostartms;
+    if (ms < 1)
+	ms = 1;
+
+    simdemototaltics += tics;
+    simdemototalms += ms;
+
+    printf ("simdemo %s: %i tics in %i ms, %i tics/s, hash %08x",
+	    sd->name, tics, ms, (int) ((long long) tics * 1000 / ms),
+	    simdemohash);
+
+    if (sd->checked)
+    {
+	if (sd->expected == simdemohash)
+	{
+	    printf (" ok\n");
+	}
+	else
+	{
+	    printf (" DESYNC (expected %08x)\n", sd->expected);
+	    simdemodesyncs++;
+	}
+    }
+    else
+    {
+	printf ("\n");
+    }
+
+    if (++simdemo < numsimdemos)
+    {
+	G_DeferedPlayDemo (simdemos[simdemo].name);
+	return;
+    }
+
+    if (simdemototalms < 1)
+	simdemototalms = 1;
+
+    // Same exit as -timedemo.
+    I_Error ("simdemos: %i demos, %i tics in %i ms (%i tics/s), %i desynced",
+	     simdemo, simdemototaltics, simdemototalms,
+	     (int) ((long long) simdemototaltics * 1000 / simdemototalms),
+	     simdemodesyncs);
+}
+
+//
+// G_SimDemos
+// Plays every demo given to G_AddSimDemo back to back.
+//
+void G_SimDemos (void)
+{
+    nodrawers = true;
+    singletics = true;
+    simdemo = 0;
+
+    G_DeferedPlayDemo (simdemos[0].name);
+}
+
+
+//
+// Demo keyframes (-demokeyframes).
+// During playback the game is archived every so many tics, in the
+// exact savegame mode, along with the demo position and the random
+// index. Restoring the nearest keyframe and running the tics after
+// it lets playback seek to any tic without replaying from the start.
+//
+// Keyframes are stored XOR'd against the one before, so that little
+// is left but the thinkers that changed, and run length coded as
+// pairs of zero and literal counts. Every KEYFRAMEGROUP'th one is
+// stored whole so a restore never decodes a long chain. The store
+// has a fixed size; once it is full no more keyframes are taken.
+//
+#define MAXKEYFRAMES	1024
+#define KEYFRAMEGROUP	8
+#define KEYFRAMEWORKSIZE 0x8000
+#define SEEKSTEP	(10*TICRATE)
+
+typedef struct
+{
+    int		tic;		// demo tics played
+    int		demopos;	// offset of the next ticcmd
+    int		prndindex;
+    boolean	paused;
+    int		length;		// of the archive
+    int		offset;		// into keyframestore
+} keyframe_t;
+
+static keyframe_t	keyframes[MAXKEYFRAMES];
+static int		numkeyframes;
+static int		keyframeinterval;	// tics, 0 if off
+static boolean		keyframesfull;
+
+static byte*		keyframestore;
+static int		keyframestoresize;
+static int		keyframestoreused;
+
+static byte*		keyframeprev;		// last keyframe, decoded
+static int		keyframeprevsize;
+static byte*		keyframework;		// archive and decode buffer
+static int		keyframeworksize;
+
+static int		seektic;
+static boolean		demorestart;		// G_DoPlayDemo keeps the keyframes
+
+void G_DemoKeyframes (int interval)
+{
+    int		i;
+
+    keyframeinterval = interval;
+    keyframestoresize = 256*1024;
+
+    //!
+    // @arg <size>
+    // @category demo
+    //
+    // Size of the demo keyframe store (KiB).
+    //
+
+    i = M_CheckParmWithArgs("-keyframemem", 1);
+    if (i)
+	keyframestoresize = atoi(myargv[i+1])*1024;
+
+    keyframestore = Z_Malloc (keyframestoresize, PU_STATIC, NULL);
+
+    keyframeprevsize = keyframeworksize = KEYFRAMEWORKSIZE;
+    keyframeprev = Z_Malloc (keyframeprevsize, PU_STATIC, NULL);
+    keyframework = Z_Malloc (keyframeworksize, PU_STATIC, NULL);
+}
+
+//
+// G_ResetDemoKeyframes
+// Called when a demo starts playing.
+//
+static void G_ResetDemoKeyframes (void)
+{
+    demotic = 0;
+    numkeyframes = 0;
+    keyframesfull = false;
+    keyframestoreused = 0;
+}
+
+#define KEYFRAMEDELTA(i) (in[i] ^ ((i) < prevlength ? prev[i] : 0))
+
+//
+// G_EncodeKeyframe
+// Codes in[0..length) XOR'd against prev[0..prevlength)
+// and returns the coded size.
+//
+static int
+G_EncodeKeyframe
+( byte*		out,
+  byte*		in,
+  int		length,
+  byte*		prev,
+  int		prevlength )
+{
+    byte*	start;
+    int		i;
+    int		zeros;
+    int		lits;
+
+    start = out;
+    i = 0;
+
+    while (i < length)
+    {
+	zeros = 0;
+	while (i < length && zeros < 255 && KEYFRAMEDELTA(i) == 0)
+	{
+	    zeros++;
+	    i++;
+	}
+
+	// a single zero byte is cheaper kept in the literals
+	lits = 0;
+	while (i + lits < length && lits < 255)
+	{
+	    if (KEYFRAMEDELTA(i + lits) == 0
+	     && (i + lits + 1 == length || KEYFRAMEDELTA(i + lits + 1) == 0))
+		break;
+
+	    out[2 + lits] = KEYFRAMEDELTA(i + lits);
+	    lits++;
+	}
+
+	out[0] = zeros;
+	out[1] = lits;
+	out += 2 + lits;
+	i += lits;
+    }
+
+    return out - start;
+}
+
+//
+// G_DecodeKeyframe
+// The reverse of G_EncodeKeyframe, in place: buffer holds the
+// previous keyframe and must have room for length bytes.
+//
+static void
+G_DecodeKeyframe
+( byte*		buffer,
+  int		length,
+  byte*		in,
+  int		prevlength )
+{
+    int		i;
+    int		zeros;
+    int		lits;
+
+    i = 0;
+
+    while (i < length)
+    {
+	zeros = *in++;
+	lits = *in++;
+
+	for ( ; zeros > 0 ; zeros--, i++)
+	    if (i >= prevlength)
+		buffer[i] = 0;
+
+	for ( ; lits > 0 ; lits--, i++)
+	    buffer[i] = *in++ ^ (i < prevlength ? buffer[i] : 0);
+    }
+}
+
+//
+// G_TakeKeyframe
+//
+static void G_TakeKeyframe (void)
+{
+    keyframe_t*	kf;
+    byte*	swap;
+    int		swapsize;
+    int		prevlength;
+
+    save_buffer = keyframework;
+    save_buffer_size = keyframeworksize;
+    savegame_exact = true;
+
+    G_ArchiveGame ("KEYFRAME");
+
+    savegame_exact = false;
+    keyframework = save_buffer;
+    keyframeworksize = save_buffer_size;
+    save_buffer = NULL;
+
+    kf = &keyframes[numkeyframes];
+
+    if (numkeyframes % KEYFRAMEGROUP == 0)
+	prevlength = 0;
+    else
+	prevlength = keyframes[numkeyframes - 1].length;
+
+    // room for the worst case of the coding
+    if (numkeyframes == MAXKEYFRAMES
+     || keyframestoreused + save_offset + save_offset/64 + 16
+	> keyframestoresize)
+    {
+	printf ("G_TakeKeyframe: store full at tic %i, %i keyframes\n",
+		demotic, numkeyframes);
+	keyframesfull = true;
+	return;
+    }
+
+    kf->tic = demotic;
+    kf->demopos = demo_p - demobuffer;
+    kf->prndindex = prndindex;
+    kf->paused = paused;
+    kf->length = save_offset;
+    kf->offset = keyframestoreused;
+
+    keyframestoreused += G_EncodeKeyframe (keyframestore + kf->offset,
+					   keyframework, kf->length,
+					   keyframeprev, prevlength);
+    numkeyframes++;
+
+    // this one is what the next is coded against
+    swap = keyframeprev;
+    swapsize = keyframeprevsize;
+    keyframeprev = keyframework;
+    keyframeprevsize = keyframeworksize;
+    keyframework = swap;
+    keyframeworksize = swapsize;
+}
+
+//
+// G_DemoKeyframeTic
+// Called at the end of each tic of demo playback.
+//
+static void G_DemoKeyframeTic (void)
+{
+    if (!keyframeinterval || keyframesfull)
+	return;
+
+    if (gamestate != GS_LEVEL || gameaction != ga_nothing)
+	return;
+
+    if (numkeyframes > 0
+     && demotic < keyframes[numkeyframes - 1].tic + keyframeinterval)
+	return;
+
+    G_TakeKeyframe ();
+}
+
+//
+// G_RestoreKeyframe
+//
+static void G_RestoreKeyframe (int k)
+{
+    keyframe_t*	kf;
+    int		i;
+    int		size;
+
+    kf = &keyframes[k];
+
+    // decode from the whole keyframe at the start of the group
+    size = 0;
+    for (i = k - k % KEYFRAMEGROUP ; i <= k ; i++)
+	if (keyframes[i].length > size)
+	    size = keyframes[i].length;
+
+    if (keyframeworksize < size)
+    {
+	Z_Free (keyframework);
+	keyframeworksize = size;
+	keyframework = Z_Malloc (keyframeworksize, PU_STATIC, NULL);
+    }
+
+    for (i = k - k % KEYFRAMEGROUP ; i <= k ; i++)
+    {
+	G_DecodeKeyframe (keyframework, keyframes[i].length,
+			  keyframestore + keyframes[i].offset,
+			  i % KEYFRAMEGROUP ? keyframes[i-1].length : 0);
+    }
+
+    save_buffer = keyframework;
+    save_buffer_size = kf->length;
+    savegame_exact = true;
+
+    precache = false;
+    G_UnArchiveGame ();
+    precache = true;
+
+    savegame_exact = false;
+    save_buffer = NULL;
+
+    // G_InitNew, if the level had to be loaded, ends the demo
+    usergame = false;
+    demoplayback = true;
+
+    demotic = kf->tic;
+    demo_p = demobuffer + kf->demopos;
+    prndindex = kf->prndindex;
+    paused = kf->paused;
+}
+
+//
+// G_SeekDemo
+// Moves demo playback to the given tic, once the current tic is done.
+//
+void G_SeekDemo (int tic)
+{
+    if (!demoplayback || !keyframeinterval)
+	return;
+
+    seektic = tic < 0 ? 0 : tic;
+    gameaction = ga_seekdemo;
+}
+
+static boolean G_DemoKeyframeResponder (event_t* ev)
+{
+    if (!keyframeinterval || automapactive || gameaction != ga_nothing
+     || ev->type != ev_keydown)
+	return false;
+
+    if (ev->data1 == KEY_LEFTARROW)
+    {
+	G_SeekDemo (demotic - SEEKSTEP);
+	return true;
+    }
+
+    if (ev->data1 == KEY_RIGHTARROW)
+    {
+	G_SeekDemo (demotic + SEEKSTEP);
+	return true;
+    }
+
+    return false;
+}
+
+void G_DoSeekDemo (void)
+{
+    int		k;
+    int		fromtic;
+    int		starttime;
+
+    gameaction = ga_nothing;
+    starttime = I_GetTimeMS ();
+
+    // the last keyframe at or before the tic
+    for (k = numkeyframes - 1 ; k > 0 ; k--)
+	if (keyframes[k].tic <= seektic)
+	    break;
+
+    // restore it, unless going on from here is closer
+    if (numkeyframes > 0 && keyframes[k].tic <= seektic)
+    {
+	if (seektic < demotic || keyframes[k].tic > demotic)
+	    G_RestoreKeyframe (k);
+    }
+    else if (seektic < demotic)
+    {
+	// before the first keyframe, so start over from the header
+	demorestart = true;
+	G_DoPlayDemo ();
+	demorestart = false;
+    }
+
+    // run the tics in between without drawing
+    fromtic = demotic;
+
+    while (demoplayback && demotic < seektic)
+	G_Ticker ();
+
+    printf ("G_DoSeekDemo: tic %i, ran %i tics from tic %i in %i ms "
+	    "(replay from the start runs %i)\n",
+	    demotic, demotic - fromtic, fromtic,
+	    I_GetTimeMS () - starttime, demotic);
+}
+
+
 //
 // G_PlayDemo 
 //
@@ -2160,12 +3062,22 @@ void G_DoPlayDemo (void)
 	netdemo = true;
     }
 
-    // don't spend a lot of time in loadlevel 
-    precache = false;
+    // R_PrecacheLevel leaves out -timedemo and -nodraw itself
     G_InitNew (skill, episode, map); 
-    precache = true; 
     starttime = I_GetTime (); 
 
+    if (demorestart)
+	demotic = 0;
+    else
+	G_ResetDemoKeyframes ();
+
+    if (numsimdemos)
+    {
+	simdemostarttic = gametic;
+	simdemostartms = I_GetTimeMS ();
+	simdemohash = 0;
+    }
+
     usergame = false; 
     demoplayback = true; 
 } 
@@ -2235,7 +3147,9 @@ boolean G_CheckDemoStatus (void)
 	nomonsters = false;
 	consoleplayer = 0;
         
-        if (singledemo) 
+        if (numsimdemos)
+            G_SimDemoDone ();
+        else if (singledemo) 
             I_Quit (); 
         else 
             D_AdvanceDemo (); 
@@ -2246,8 +3160,16 @@ boolean G_CheckDemoStatus (void)
     if (demorecording) 
     { 
 	*demo_p++ = DEMOMARKER; 
-	M_WriteFile (demoname, demobuffer, demo_p - demobuffer); 
-	Z_Free (demobuffer); 
+
+	if (demostream != NULL)
+	{
+	    G_FinishDemoStream ();
+	}
+	else
+	{
+	    M_WriteFile (demoname, demobuffer, demo_p - demobuffer); 
+	    Z_Free (demobuffer); 
+	}
 	demorecording = false; 
 	I_Error ("Demo %s recorded",demoname); 
     } 
@@ -48,13 +48,23 @@ void G_DoLoadGame (void);
 // Called by M_Responder.
 void G_SaveGame (int slot, char* description);
 
+// In-RAM quicksave (-ramsave).
+void G_SaveSnapshot (void);
+void G_LoadSnapshot (void);
+extern boolean ramsave;
+
 // Only called by startup code.
 void G_RecordDemo (char* name);
 
 void G_BeginRecording (void);
+void G_UpdateDemoStream (void);
 
 void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
+void G_AddSimDemo (char* name, char* expected);
+void G_SimDemos (void);
+void G_DemoKeyframes (int interval);
+void G_SeekDemo (int tic);
 boolean G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
@@ -66,6 +76,10 @@ void G_WorldDone (void);
 
 void G_BuildTiccmd (ticcmd_t *cmd, int maketic); 
 
+// View angle turn from the latest input, for -latelatch.
+
+int G_LatchedTurn (void);
+
 void G_Ticker (void);
 boolean G_Responder (event_t*	ev);
 
@@ -688,6 +688,13 @@ void M_QuickSave(void)
 
     if (gamestate != GS_LEVEL)
 	return;
+
+    if (ramsave && !netgame)
+    {
+	G_SaveSnapshot();
+	S_StartSound(NULL,sfx_swtchx);
+	return;
+    }
 	
     if (quickSaveSlot < 0)
     {
@@ -723,6 +730,13 @@ void M_QuickLoad(void)
 	M_StartMessage(QLOADNET,NULL,false);
 	return;
     }
+
+    if (ramsave)
+    {
+	G_LoadSnapshot();
+	S_StartSound(NULL,sfx_swtchx);
+	return;
+    }
 	
     if (quickSaveSlot < 0)
     {
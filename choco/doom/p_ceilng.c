@@ -290,6 +290,7 @@ void P_ActivateInStasisCeiling(line_t* line)
 	    activeceilings[i]->direction = activeceilings[i]->olddirection;
 	    activeceilings[i]->thinker.function.acp1
 	      = (actionf_p1)T_MoveCeiling;
+	    P_WakeThinker (&activeceilings[i]->thinker);
 	}
     }
 }
@@ -800,6 +800,8 @@ P_DamageMobj
     if (target->health <= 0)
 	return;
 
+    P_WakeThinker (&target->thinker);
+
     if ( target->flags & MF_SKULLFLY )
     {
 	target->momx = target->momy = target->momz = 0;
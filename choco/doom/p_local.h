@@ -70,6 +70,7 @@ extern	thinker_t	thinkercap;
 void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
+void P_WakeThinker (thinker_t* thinker);
 
 
 //
@@ -95,6 +96,11 @@ void	P_PlayerThink (player_t* player);
 // Time interval for item respawning.
 #define ITEMQUESIZE		128
 
+// live mobjs, in thinker order, as a whole and by type;
+// walk with lnext and tnext respectively
+extern mobj_t*		mobjlist;
+extern mobj_t*		mobjtypelist[NUMMOBJTYPES];
+
 extern mapthing_t	itemrespawnque[ITEMQUESIZE];
 extern int		itemrespawntime[ITEMQUESIZE];
 extern int		iquehead;
@@ -111,9 +117,13 @@ P_SpawnMobj
   mobjtype_t	type );
 
 void 	P_RemoveMobj (mobj_t* th);
+void	P_FreeMobj (mobj_t* mobj);
+void	P_InitMobjLists (void);
+void	P_LinkMobjLists (mobj_t* mobj);
 mobj_t* P_SubstNullMobj (mobj_t* th);
 boolean	P_SetMobjState (mobj_t* mobj, statenum_t state);
 void 	P_MobjThinker (mobj_t* mobj);
+boolean	P_MobjIsIdle (mobj_t* mobj);
 
 void	P_SpawnPuff (fixed_t x, fixed_t y, fixed_t z);
 void 	P_SpawnBlood (fixed_t x, fixed_t y, fixed_t z, int damage);
@@ -126,6 +136,11 @@ void	P_SpawnPlayerMissile (mobj_t* source, mobjtype_t type);
 //
 void P_NoiseAlert (mobj_t* target, mobj_t* emmiter);
 
+// the boss brain's spawn spots
+extern mobj_t*		braintargets[32];
+extern int		numbraintargets;
+extern int		braintargeton;
+
 
 //
 // P_MAPUTL
@@ -165,6 +180,8 @@ int 	P_PointOnDivlineSide (fixed_t x, fixed_t y, divline_t* line);
 void 	P_MakeDivline (line_t* li, divline_t* dl);
 fixed_t P_InterceptVector (divline_t* v2, divline_t* v1);
 int 	P_BoxOnLineSide (fixed_t* tmbox, line_t* ld);
+int 	P_PointOnLineCollSide (fixed_t x, fixed_t y, linecoll_t* lc);
+int 	P_BoxOnLineCollSide (fixed_t* tmbox, linecoll_t* lc);
 
 extern fixed_t		opentop;
 extern fixed_t 		openbottom;
@@ -227,6 +244,23 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+void	P_ClearSightCache (void);
+
+// sight checks answered from the cache / by a BSP traversal
+extern int	sightcachehits;
+extern int	sightcachemisses;
+
+
+//
+// P_PVS
+//
+extern byte*	sightpvs;	// NULL unless -sightpvs
+extern int	sightpvsrowbytes;
+extern boolean	sightpvscheck;
+extern int	sightpvsmismatches;
+
+void	P_InitSightPVS (char* lumpname, int lumpnum);
+boolean	P_SightPVSRejects (mobj_t* t1, mobj_t* t2);
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
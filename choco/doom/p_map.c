@@ -205,13 +205,17 @@ static void SpechitOverrun(line_t *ld);
 //
 boolean PIT_CheckLine (line_t* ld)
 {
-    if (tmbbox[BOXRIGHT] <= ld->bbox[BOXLEFT]
-	|| tmbbox[BOXLEFT] >= ld->bbox[BOXRIGHT]
-	|| tmbbox[BOXTOP] <= ld->bbox[BOXBOTTOM]
-	|| tmbbox[BOXBOTTOM] >= ld->bbox[BOXTOP] )
+    linecoll_t*	lc;
+
+    lc = &linecolls[ld - lines];
+
+    if (tmbbox[BOXRIGHT] <= lc->bbox[BOXLEFT]
+	|| tmbbox[BOXLEFT] >= lc->bbox[BOXRIGHT]
+	|| tmbbox[BOXTOP] <= lc->bbox[BOXBOTTOM]
+	|| tmbbox[BOXBOTTOM] >= lc->bbox[BOXTOP] )
 	return true;
 
-    if (P_BoxOnLineSide (tmbbox, ld) != -1)
+    if (P_BoxOnLineCollSide (tmbbox, lc) != -1)
 	return true;
 		
     // A line has been hit
@@ -577,6 +581,10 @@ boolean P_ThingHeightClip (mobj_t* thing)
 	if (thing->z+thing->height > thing->ceilingz)
 	    thing->z = thing->ceilingz - thing->height;
     }
+
+    // left hanging by the sector change
+    if (thing->z != thing->floorz)
+	P_WakeThinker (&thing->thinker);
 	
     if (thing->ceilingz - thing->floorz < thing->height)
 	return false;
@@ -1374,6 +1382,9 @@ P_ChangeSector
 	
     nofit = false;
     crushchange = crunch;
+
+    // plane heights changed, cached sight lines may be blocked now
+    P_ClearSightCache ();
 	
     // re-check heights for all things near the moving sector
     for (x=sector->blockbox[BOXLEFT] ; x<= sector->blockbox[BOXRIGHT] ; x++)
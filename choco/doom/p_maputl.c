@@ -54,40 +54,40 @@ P_AproxDistance
 
 
 //
-// P_PointOnLineSide
+// P_PointOnLineCollSide
 // Returns 0 or 1
 //
 int
-P_PointOnLineSide
+P_PointOnLineCollSide
 ( fixed_t	x,
   fixed_t	y,
-  line_t*	line )
+  linecoll_t*	lc )
 {
     fixed_t	dx;
     fixed_t	dy;
     fixed_t	left;
     fixed_t	right;
 	
-    if (!line->dx)
+    if (!lc->dx)
     {
-	if (x <= line->v1->x)
-	    return line->dy > 0;
+	if (x <= lc->x)
+	    return lc->dy > 0;
 	
-	return line->dy < 0;
+	return lc->dy < 0;
     }
-    if (!line->dy)
+    if (!lc->dy)
     {
-	if (y <= line->v1->y)
-	    return line->dx < 0;
+	if (y <= lc->y)
+	    return lc->dx < 0;
 	
-	return line->dx > 0;
+	return lc->dx > 0;
     }
 	
-    dx = (x - line->v1->x);
-    dy = (y - line->v1->y);
+    dx = (x - lc->x);
+    dy = (y - lc->y);
 	
-    left = FixedMul ( line->dy>>FRACBITS , dx );
-    right = FixedMul ( dy , line->dx>>FRACBITS );
+    left = FixedMul ( lc->dy>>FRACBITS , dx );
+    right = FixedMul ( dy , lc->dx>>FRACBITS );
 	
     if (right < left)
 	return 0;		// front side
@@ -95,26 +95,40 @@ P_PointOnLineSide
 }
 
 
+//
+// P_PointOnLineSide
+// Returns 0 or 1
+//
+int
+P_PointOnLineSide
+( fixed_t	x,
+  fixed_t	y,
+  line_t*	line )
+{
+    return P_PointOnLineCollSide (x, y, &linecolls[line - lines]);
+}
+
+
 
 //
-// P_BoxOnLineSide
+// P_BoxOnLineCollSide
 // Considers the line to be infinite
 // Returns side 0 or 1, -1 if box crosses the line.
 //
 int
-P_BoxOnLineSide
+P_BoxOnLineCollSide
 ( fixed_t*	tmbox,
-  line_t*	ld )
+  linecoll_t*	lc )
 {
     int		p1 = 0;
     int		p2 = 0;
 	
-    switch (ld->slopetype)
+    switch (lc->slopetype)
     {
       case ST_HORIZONTAL:
-	p1 = tmbox[BOXTOP] > ld->v1->y;
-	p2 = tmbox[BOXBOTTOM] > ld->v1->y;
-	if (ld->dx < 0)
+	p1 = tmbox[BOXTOP] > lc->y;
+	p2 = tmbox[BOXBOTTOM] > lc->y;
+	if (lc->dx < 0)
 	{
 	    p1 ^= 1;
 	    p2 ^= 1;
@@ -122,9 +136,9 @@ P_BoxOnLineSide
 	break;
 	
       case ST_VERTICAL:
-	p1 = tmbox[BOXRIGHT] < ld->v1->x;
-	p2 = tmbox[BOXLEFT] < ld->v1->x;
-	if (ld->dy < 0)
+	p1 = tmbox[BOXRIGHT] < lc->x;
+	p2 = tmbox[BOXLEFT] < lc->x;
+	if (lc->dy < 0)
 	{
 	    p1 ^= 1;
 	    p2 ^= 1;
@@ -132,13 +146,13 @@ P_BoxOnLineSide
 	break;
 	
       case ST_POSITIVE:
-	p1 = P_PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXTOP], ld);
-	p2 = P_PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXBOTTOM], ld);
+	p1 = P_PointOnLineCollSide (tmbox[BOXLEFT], tmbox[BOXTOP], lc);
+	p2 = P_PointOnLineCollSide (tmbox[BOXRIGHT], tmbox[BOXBOTTOM], lc);
 	break;
 	
       case ST_NEGATIVE:
-	p1 = P_PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXTOP], ld);
-	p2 = P_PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXBOTTOM], ld);
+	p1 = P_PointOnLineCollSide (tmbox[BOXRIGHT], tmbox[BOXTOP], lc);
+	p2 = P_PointOnLineCollSide (tmbox[BOXLEFT], tmbox[BOXBOTTOM], lc);
 	break;
     }
 
@@ -148,6 +162,20 @@ P_BoxOnLineSide
 }
 
 
+//
+// P_BoxOnLineSide
+// Considers the line to be infinite
+// Returns side 0 or 1, -1 if box crosses the line.
+//
+int
+P_BoxOnLineSide
+( fixed_t*	tmbox,
+  line_t*	ld )
+{
+    return P_BoxOnLineCollSide (tmbox, &linecolls[ld - lines]);
+}
+
+
 //
 // P_PointOnDivlineSide
 // Returns 0 or 1.
@@ -562,6 +590,9 @@ PIT_AddLineIntercepts (line_t* ld)
     int			s2;
     fixed_t		frac;
     divline_t		dl;
+    linecoll_t*		lc;
+
+    lc = &linecolls[ld - lines];
 	
     // avoid precision problems with two routines
     if ( trace.dx > FRACUNIT*16
@@ -569,20 +600,23 @@ PIT_AddLineIntercepts (line_t* ld)
 	 || trace.dx < -FRACUNIT*16
 	 || trace.dy < -FRACUNIT*16)
     {
-	s1 = P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace);
-	s2 = P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace);
+	s1 = P_PointOnDivlineSide (lc->x, lc->y, &trace);
+	s2 = P_PointOnDivlineSide (lc->x+lc->dx, lc->y+lc->dy, &trace);
     }
     else
     {
-	s1 = P_PointOnLineSide (trace.x, trace.y, ld);
-	s2 = P_PointOnLineSide (trace.x+trace.dx, trace.y+trace.dy, ld);
+	s1 = P_PointOnLineCollSide (trace.x, trace.y, lc);
+	s2 = P_PointOnLineCollSide (trace.x+trace.dx, trace.y+trace.dy, lc);
     }
     
     if (s1 == s2)
 	return true;	// line isn't crossed
     
     // hit the line
-    P_MakeDivline (ld, &dl);
+    dl.x = lc->x;
+    dl.y = lc->y;
+    dl.dx = lc->dx;
+    dl.dy = lc->dy;
     frac = P_InterceptVector (&trace, &dl);
 
     if (frac < 0)
@@ -674,12 +708,49 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
 
 
 //
-// P_TraverseIntercepts
-// Returns true if the traverser function returns true
-// for all lines.
-// 
-boolean
-P_TraverseIntercepts
+// Binary heap of pending intercepts, nearest first. Ties go to
+// the one added first, which is the one the linear scan below
+// would have picked, so traversal order is unchanged.
+//
+static intercept_t*	interceptheap[MAXINTERCEPTS];
+
+#define INTERCEPT_BEFORE(a,b) \
+    ((a)->frac < (b)->frac || ((a)->frac == (b)->frac && (a) < (b)))
+
+static void P_SiftIntercept (int i, int count)
+{
+    intercept_t*	in;
+    int			child;
+
+    in = interceptheap[i];
+
+    while ((child = 2*i + 1) < count)
+    {
+	if (child + 1 < count
+	    && INTERCEPT_BEFORE(interceptheap[child + 1], interceptheap[child]))
+	{
+	    child++;
+	}
+
+	if (!INTERCEPT_BEFORE(interceptheap[child], in))
+	    break;
+
+	interceptheap[i] = interceptheap[child];
+	i = child;
+    }
+
+    interceptheap[i] = in;
+}
+
+
+//
+// P_ScanIntercepts
+// The original traversal, repeatedly scanning the whole list
+// for the closest intercept. Only used if the list has run
+// past the end of intercepts[].
+//
+static boolean
+P_ScanIntercepts
 ( traverser_t	func,
   fixed_t	maxfrac )
 {
@@ -707,22 +778,55 @@ P_TraverseIntercepts
 	if (dist > maxfrac)
 	    return true;	// checked everything in range		
 
-#if 0  // UNUSED
-    {
-	// don't check these yet, there may be others inserted
-	in = scan = intercepts;
-	for ( scan = intercepts ; scan<intercept_p ; scan++)
-	    if (scan->frac > maxfrac)
-		*in++ = *scan;
-	intercept_p = in;
-	return false;
+        if ( !func (in) )
+	    return false;	// don't bother going farther
+
+	in->frac = INT_MAX;
     }
-#endif
+	
+    return true;		// everything was traversed
+}
+
+
+//
+// P_TraverseIntercepts
+// Returns true if the traverser function returns true
+// for all lines.
+// 
+boolean
+P_TraverseIntercepts
+( traverser_t	func,
+  fixed_t	maxfrac )
+{
+    int			count;
+    int			i;
+    intercept_t*	in;
+	
+    count = intercept_p - intercepts;
+
+    if (count > MAXINTERCEPTS)
+	return P_ScanIntercepts (func, maxfrac);
+
+    for (i = 0 ; i < count ; i++)
+	interceptheap[i] = &intercepts[i];
+
+    for (i = count/2 - 1 ; i >= 0 ; i--)
+	P_SiftIntercept (i, count);
+	
+    while (count)
+    {
+	in = interceptheap[0];
+
+	if (in->frac > maxfrac)
+	    return true;	// checked everything in range		
 
         if ( !func (in) )
 	    return false;	// don't bother going farther
 
 	in->frac = INT_MAX;
+
+	interceptheap[0] = interceptheap[--count];
+	P_SiftIntercept (0, count);
     }
 	
     return true;		// everything was traversed
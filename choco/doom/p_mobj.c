@@ -51,6 +51,8 @@ P_SetMobjState
 {
     state_t*	st;
 
+    P_WakeThinker (&mobj->thinker);
+
     do
     {
 	if (state == S_NULL)
@@ -499,6 +501,34 @@ void P_MobjThinker (mobj_t* mobj)
 }
 
 
+//
+// P_MobjIsIdle
+// True if P_MobjThinker would do nothing for this mobj,
+// and keep doing nothing until something else changes it
+// and calls P_WakeThinker.
+//
+boolean P_MobjIsIdle (mobj_t* mobj)
+{
+    if (mobj->tics != -1
+	|| mobj->momx
+	|| mobj->momy
+	|| mobj->momz
+	|| mobj->z != mobj->floorz
+	|| (mobj->flags & MF_SKULLFLY))
+	return false;
+
+    // players are pushed around by P_PlayerThink
+    if (mobj->player)
+	return false;
+
+    // counts towards nightmare respawn
+    if ((mobj->flags & MF_COUNTKILL) && respawnmonsters)
+	return false;
+
+    return true;
+}
+
+
 //
 // P_SpawnMobj
 //
@@ -555,11 +585,92 @@ P_SpawnMobj
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
     P_AddThinker (&mobj->thinker);
+    P_LinkMobjLists (mobj);
 
     return mobj;
 }
 
 
+//
+// MOBJ LISTS
+// Every mobj in the thinker list is also on the live list and on
+// the list for its type. Both are appended to in step with
+// P_AddThinker, so walking them visits mobjs in the same order as
+// a scan of the thinker list would. P_RemoveMobj unlinks at once,
+// where the thinker itself lingers until its turn comes up.
+//
+mobj_t*		mobjlist;
+mobj_t*		mobjtypelist[NUMMOBJTYPES];
+
+static mobj_t*	mobjtail;
+static mobj_t*	mobjtypetail[NUMMOBJTYPES];
+
+
+void P_InitMobjLists (void)
+{
+    int		i;
+
+    mobjlist = mobjtail = NULL;
+
+    for (i=0 ; i<NUMMOBJTYPES ; i++)
+	mobjtypelist[i] = mobjtypetail[i] = NULL;
+}
+
+
+void P_LinkMobjLists (mobj_t* mobj)
+{
+    mobj->lnext = NULL;
+    mobj->lprev = mobjtail;
+
+    if (mobjtail)
+	mobjtail->lnext = mobj;
+    else
+	mobjlist = mobj;
+
+    mobjtail = mobj;
+
+    mobj->tnext = NULL;
+    mobj->tprev = mobjtypetail[mobj->type];
+
+    if (mobjtypetail[mobj->type])
+	mobjtypetail[mobj->type]->tnext = mobj;
+    else
+	mobjtypelist[mobj->type] = mobj;
+
+    mobjtypetail[mobj->type] = mobj;
+}
+
+
+static void P_UnlinkMobjLists (mobj_t* mobj)
+{
+    // already removed once this tic
+    if (mobj->lnext == mobj)
+	return;
+
+    if (mobj->lnext)
+	mobj->lnext->lprev = mobj->lprev;
+    else
+	mobjtail = mobj->lprev;
+
+    if (mobj->lprev)
+	mobj->lprev->lnext = mobj->lnext;
+    else
+	mobjlist = mobj->lnext;
+
+    if (mobj->tnext)
+	mobj->tnext->tprev = mobj->tprev;
+    else
+	mobjtypetail[mobj->type] = mobj->tprev;
+
+    if (mobj->tprev)
+	mobj->tprev->tnext = mobj->tnext;
+    else
+	mobjtypelist[mobj->type] = mobj->tnext;
+
+    mobj->lnext = mobj->tnext = mobj;
+}
+
+
 //
 // P_RemoveMobj
 //
@@ -590,12 +701,29 @@ void P_RemoveMobj (mobj_t* mobj)
     
     // stop any playing sound
     S_StopSound (mobj);
+
+    P_UnlinkMobjLists (mobj);
     
     // free block
     P_RemoveThinker ((thinker_t*)mobj);
 }
 
 
+//
+// P_FreeMobj
+// Unlinks a mobj and frees it at once, for when the whole
+// thinker list is being thrown away. Nothing goes on the item
+// respawn queue.
+//
+void P_FreeMobj (mobj_t* mobj)
+{
+    P_UnsetThingPosition (mobj);
+    S_StopSound (mobj);
+    P_UnlinkMobjLists (mobj);
+    Z_Free (mobj);
+}
+
+
 
 
 //
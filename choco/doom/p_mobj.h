@@ -200,6 +200,11 @@ typedef enum
 // Map Object definition.
 typedef struct mobj_s
 {
+    // The fields read every tic by the thinkers, the movement
+    // code and the sprite projection come first, so that they
+    // share the first couple of cache lines of the block.
+    // Savegames do not depend on this order, see p_saveg.c.
+
     // List: thinker links.
     thinker_t		thinker;
 
@@ -208,20 +213,20 @@ typedef struct mobj_s
     fixed_t		y;
     fixed_t		z;
 
-    // More list: links in sector (if needed)
-    struct mobj_s*	snext;
-    struct mobj_s*	sprev;
+    // Momentums, used to update position.
+    fixed_t		momx;
+    fixed_t		momy;
+    fixed_t		momz;
+
+    int			flags;
+    int			tics;	// state tic counter
+    state_t*		state;
 
     //More drawing info: to determine current sprite.
-    angle_t		angle;	// orientation
     spritenum_t		sprite;	// used to find patch_t and flip value
     int			frame;	// might be ORed with FF_FULLBRIGHT
+    angle_t		angle;	// orientation
 
-    // Interaction info, by BLOCKMAP.
-    // Links in blocks (if needed).
-    struct mobj_s*	bnext;
-    struct mobj_s*	bprev;
-    
     struct subsector_s*	subsector;
 
     // The closest interval over all contacted Sectors.
@@ -232,20 +237,24 @@ typedef struct mobj_s
     fixed_t		radius;
     fixed_t		height;	
 
-    // Momentums, used to update position.
-    fixed_t		momx;
-    fixed_t		momy;
-    fixed_t		momz;
+    // Interaction info, by BLOCKMAP.
+    // Links in blocks (if needed).
+    struct mobj_s*	bnext;
+    struct mobj_s*	bprev;
+
+    // More list: links in sector (if needed)
+    struct mobj_s*	snext;
+    struct mobj_s*	sprev;
 
     // If == validcount, already checked.
     int			validcount;
 
+    // Everything below is only touched by the action
+    // functions, spawning and the savegame code.
+
     mobjtype_t		type;
     mobjinfo_t*		info;	// &mobjinfo[mobj->type]
     
-    int			tics;	// state tic counter
-    state_t*		state;
-    int			flags;
     int			health;
 
     // Movement direction, movement generation (zig-zagging).
@@ -276,6 +285,14 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // List: live mobjs, in thinker order.
+    struct mobj_s*	lnext;
+    struct mobj_s*	lprev;
+
+    // List: live mobjs of the same type, in thinker order.
+    struct mobj_s*	tnext;
+    struct mobj_s*	tprev;
     
 } mobj_t;
 
@@ -257,6 +257,7 @@ void P_ActivateInStasis(int tag)
 	    (activeplats[i])->status = (activeplats[i])->oldstatus;
 	    (activeplats[i])->thinker.function.acp1
 	      = (actionf_p1) T_PlatRaise;
+	    P_WakeThinker (&(activeplats[i])->thinker);
 	}
 }
 
@@ -0,0 +1,1185 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Subsector potentially visible sets, used by P_CheckSight
+//	to skip the BSP walk for pairs that can never see each other.
+//
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "m_misc.h"
+#include "sha1.h"
+#include "w_checksum.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "p_local.h"
+
+// State.
+#include "r_state.h"
+
+
+//
+// SIGHT PVS
+// One bit per pair of subsectors, clear if no straight line from
+//  anywhere in one reaches the other without crossing a one sided
+//  line. Heights are ignored, so every two sided line counts as
+//  open and the set stays valid while doors and lifts move.
+// It is built by flowing through the portals between subsector
+//  polygons, clipping each portal to what the ones before it let
+//  through. Every clip leaves PVS_MARGIN units of slack for the
+//  fixed point rounding in the exact trace, and a subsector that
+//  takes too long falls back to plain reachability.
+// The sets are written next to the savegames, one file per map,
+//  keyed by the checksum of the WAD directory.
+//
+#define PVS_FILEVERSION	2
+
+#define PVS_MARGIN	4.0	// map units of slack on every clip
+#define PVS_EPSILON	(1.0/64)
+#define PVS_ONLINE	0.5	// seg lies along a portal
+#define PVS_GUARD	8	// units kept from walls and partitions
+
+#define PVS_MAXPOLY	64	// vertices of one BSP cell
+#define PVS_MAXDEPTH	64	// BSP depth
+#define PVS_MAXPIECES	16	// openings left in one portal
+#define PVS_MAXFLOW	512	// portals on one flow path
+#define PVS_FLOWLIMIT	16384	// portals tried from one subsector
+
+typedef struct
+{
+    double	x;
+    double	y;
+
+} pvspoint_t;
+
+// a line through o along the unit vector dx,dy
+typedef struct
+{
+    pvspoint_t	o;
+    double	dx;
+    double	dy;
+
+} pvsline_t;
+
+// the subsector on the other side is in front of p[0] -> p[1]
+typedef struct
+{
+    pvspoint_t	p[2];
+    int		from;
+    int		leaf;
+
+} pvsportal_t;
+
+// part of a partition line bordering a subsector
+typedef struct
+{
+    int		leaf;
+    double	t[2];
+
+} pvsspan_t;
+
+typedef struct
+{
+    int		leaf;
+    int		next;		// next portal of leaf to try
+    pvspoint_t	source[2];
+    pvspoint_t	pass[2];
+
+} pvsflow_t;
+
+typedef struct
+{
+    char		magic[8];
+    int			version;
+    sha1_digest_t	digest;		// W_Checksum of the directory
+    int			lumpnum;
+    int			numsubsectors;
+    int			numnodes;
+    int			numsegs;
+
+} pvsheader_t;
+
+byte*		sightpvs;
+int		sightpvsrowbytes;
+boolean		sightpvscheck;
+int		sightpvsmismatches;
+
+// map bounds, for the run time guard
+static fixed_t	pvsbbox[4];
+
+static pvspoint_t*	polys;		// [PVS_MAXDEPTH][PVS_MAXPOLY]
+
+static pvsportal_t*	portals;
+static int		numportals;
+static int		maxportals;
+static int*		firstportal;	// [numsubsectors+1]
+
+static pvsspan_t*	spans;
+static int		numspans;
+static int		maxspans;
+
+
+//
+// PVS_Grow
+// Makes room for one more element in a zone array.
+//
+static void *PVS_Grow (void *array, int count, int *max, int size)
+{
+    void*	newarray;
+
+    if (count < *max)
+	return array;
+
+    *max = *max ? *max * 2 : 256;
+    newarray = Z_Malloc (*max * size, PU_STATIC, NULL);
+
+    if (array != NULL)
+    {
+	memcpy (newarray, array, count * size);
+	Z_Free (array);
+    }
+
+    return newarray;
+}
+
+
+//
+// PVS_MakeLine
+// Returns false if a and b are too close to define a line.
+//
+static boolean PVS_MakeLine (pvspoint_t a, pvspoint_t b, pvsline_t *line)
+{
+    double	dx = b.x - a.x;
+    double	dy = b.y - a.y;
+    double	len = sqrt (dx*dx + dy*dy);
+
+    if (len < PVS_EPSILON)
+	return false;
+
+    line->o = a;
+    line->dx = dx / len;
+    line->dy = dy / len;
+    return true;
+}
+
+
+static void PVS_FixedLine (fixed_t x, fixed_t y, fixed_t dx, fixed_t dy,
+			   pvsline_t *line)
+{
+    pvspoint_t	a;
+    pvspoint_t	b;
+
+    a.x = (double) x / FRACUNIT;
+    a.y = (double) y / FRACUNIT;
+    b.x = a.x + (double) dx / FRACUNIT;
+    b.y = a.y + (double) dy / FRACUNIT;
+
+    if (!PVS_MakeLine (a, b, line))
+    {
+	line->o = a;
+	line->dx = 1;
+	line->dy = 0;
+    }
+}
+
+
+//
+// PVS_Side
+// Signed distance of p from the line, negative in front,
+//  as with R_PointOnSide.
+//
+static double PVS_Side (pvsline_t *line, pvspoint_t p)
+{
+    return (p.y - line->o.y) * line->dx - (p.x - line->o.x) * line->dy;
+}
+
+
+static pvspoint_t PVS_LinePoint (pvsline_t *line, double t)
+{
+    pvspoint_t	p;
+
+    p.x = line->o.x + t * line->dx;
+    p.y = line->o.y + t * line->dy;
+    return p;
+}
+
+
+//
+// PVS_ClipRange
+// Limits t0..t1 to where s0 + t*ds >= 0.
+//
+static boolean PVS_ClipRange (double s0, double ds, double *t0, double *t1)
+{
+    double	t;
+
+    if (fabs (ds) < 1e-12)
+	return s0 >= 0;
+
+    t = -s0 / ds;
+
+    if (ds > 0)
+    {
+	if (t > *t0)
+	    *t0 = t;
+    }
+    else
+    {
+	if (t < *t1)
+	    *t1 = t;
+    }
+
+    return *t0 <= *t1;
+}
+
+
+//
+// PVS_ClipPoly
+// Keeps the part of a convex polygon in front of the line
+//  (side -1) or behind it (side 1). Returns the new vertex
+//  count, or -1 if the polygon grew too large.
+//
+static int PVS_ClipPoly (pvspoint_t *in, int count, pvspoint_t *out,
+			 pvsline_t *line, int side)
+{
+    int		i;
+    int		n;
+    double	d0;
+    double	d1;
+    double	frac;
+    pvspoint_t	p0;
+    pvspoint_t	p1;
+
+    n = 0;
+
+    for (i=0 ; i<count ; i++)
+    {
+	p0 = in[i];
+	p1 = in[(i+1) % count];
+	d0 = side * PVS_Side (line, p0);
+	d1 = side * PVS_Side (line, p1);
+
+	if (n >= PVS_MAXPOLY - 2)
+	    return -1;
+
+	if (d0 >= 0)
+	    out[n++] = p0;
+
+	if ((d0 > 0 && d1 < 0) || (d0 < 0 && d1 > 0))
+	{
+	    frac = d0 / (d0 - d1);
+	    out[n].x = p0.x + frac * (p1.x - p0.x);
+	    out[n].y = p0.y + frac * (p1.y - p0.y);
+	    n++;
+	}
+    }
+
+    return n;
+}
+
+
+//
+// PVS_ClipSegment
+// Keeps the part of a segment where side times the distance
+//  from the line is at least -PVS_MARGIN.
+//
+static boolean PVS_ClipSegment (pvspoint_t *seg, pvsline_t *line, int side)
+{
+    double	d0;
+    double	d1;
+    double	frac;
+    pvspoint_t	p0;
+
+    d0 = side * PVS_Side (line, seg[0]) + PVS_MARGIN;
+    d1 = side * PVS_Side (line, seg[1]) + PVS_MARGIN;
+
+    if (d0 < 0 && d1 < 0)
+	return false;
+
+    p0 = seg[0];
+
+    if (d0 < 0)
+    {
+	frac = d0 / (d0 - d1);
+	seg[0].x = p0.x + frac * (seg[1].x - p0.x);
+	seg[0].y = p0.y + frac * (seg[1].y - p0.y);
+    }
+    else if (d1 < 0)
+    {
+	frac = d0 / (d0 - d1);
+	seg[1].x = p0.x + frac * (seg[1].x - p0.x);
+	seg[1].y = p0.y + frac * (seg[1].y - p0.y);
+    }
+
+    return true;
+}
+
+
+//
+// PVS_ClipSeparators
+// Clips target to the lines that can pass from source
+//  through pass. Returns false if nothing is left.
+//
+static boolean PVS_ClipSeparators (pvspoint_t *source, pvspoint_t *pass,
+				   pvspoint_t *target)
+{
+    int		i;
+    int		j;
+    double	ds;
+    double	dp;
+    pvsline_t	line;
+
+    for (i=0 ; i<2 ; i++)
+    {
+	for (j=0 ; j<2 ; j++)
+	{
+	    if (!PVS_MakeLine (source[i], pass[j], &line))
+		continue;
+
+	    // a separator has the rest of source on one side
+	    // and the rest of pass on the other
+	    ds = PVS_Side (&line, source[!i]);
+	    dp = PVS_Side (&line, pass[!j]);
+
+	    if (ds > PVS_EPSILON && dp < -PVS_EPSILON)
+	    {
+		if (!PVS_ClipSegment (target, &line, -1))
+		    return false;
+	    }
+	    else if (ds < -PVS_EPSILON && dp > PVS_EPSILON)
+	    {
+		if (!PVS_ClipSegment (target, &line, 1))
+		    return false;
+	    }
+	}
+    }
+
+    return true;
+}
+
+
+//
+// PVS_Blocks
+// True if the exact trace always stops at this seg's line.
+//
+static boolean PVS_Blocks (seg_t *seg)
+{
+    return seg->linedef->backsector == NULL
+	|| !(seg->linedef->flags & ML_TWOSIDED);
+}
+
+
+static boolean PVS_SegLine (seg_t *seg, pvspoint_t *v1, pvspoint_t *v2,
+			    pvsline_t *line)
+{
+    v1->x = (double) seg->v1->x / FRACUNIT;
+    v1->y = (double) seg->v1->y / FRACUNIT;
+    v2->x = (double) seg->v2->x / FRACUNIT;
+    v2->y = (double) seg->v2->y / FRACUNIT;
+
+    return PVS_MakeLine (*v1, *v2, line);
+}
+
+
+static void PVS_AddPortal (pvspoint_t p0, pvspoint_t p1, int from, int leaf)
+{
+    pvsportal_t*	portal;
+
+    portals = PVS_Grow (portals, numportals, &maxportals, sizeof(*portals));
+    portal = &portals[numportals++];
+    portal->p[0] = p0;
+    portal->p[1] = p1;
+    portal->from = from;
+    portal->leaf = leaf;
+}
+
+
+//
+// PVS_AddPortalPair
+// Connects the subsectors on either side of t0..t1 along a
+//  partition, leaving out anything behind their segs and any
+//  one sided line lying on the partition.
+//
+static void PVS_AddPortalPair (pvsline_t *line, int front, int back,
+			       double t0, double t1)
+{
+    int		i;
+    int		j;
+    int		k;
+    int		leaf;
+    int		numpieces;
+    double	pieces[PVS_MAXPIECES][2];
+    double	lo;
+    double	hi;
+    pvsline_t	segline;
+    pvspoint_t	v1;
+    pvspoint_t	v2;
+    seg_t*	seg;
+
+    // first keep to the front of both subsectors' segs
+    for (k=0 ; k<2 ; k++)
+    {
+	leaf = k ? back : front;
+	seg = &segs[subsectors[leaf].firstline];
+
+	for (i=subsectors[leaf].numlines ; i ; i--, seg++)
+	{
+	    if (!PVS_SegLine (seg, &v1, &v2, &segline))
+		continue;
+
+	    if (fabs (PVS_Side (line, v1)) <= PVS_ONLINE
+	     && fabs (PVS_Side (line, v2)) <= PVS_ONLINE)
+		continue;
+
+	    if (!PVS_ClipRange (PVS_MARGIN - PVS_Side (&segline, line->o),
+				segline.dy * line->dx - segline.dx * line->dy,
+				&t0, &t1))
+		return;
+	}
+    }
+
+    numpieces = 1;
+    pieces[0][0] = t0;
+    pieces[0][1] = t1;
+
+    // then cut out the walls lying along the partition,
+    // shortened by the margin
+    for (k=0 ; k<2 ; k++)
+    {
+	leaf = k ? back : front;
+	seg = &segs[subsectors[leaf].firstline];
+
+	for (i=subsectors[leaf].numlines ; i ; i--, seg++)
+	{
+	    if (!PVS_Blocks (seg) || !PVS_SegLine (seg, &v1, &v2, &segline))
+		continue;
+
+	    if (fabs (PVS_Side (line, v1)) > PVS_ONLINE
+	     || fabs (PVS_Side (line, v2)) > PVS_ONLINE)
+		continue;
+
+	    lo = (v1.x - line->o.x) * line->dx + (v1.y - line->o.y) * line->dy;
+	    hi = (v2.x - line->o.x) * line->dx + (v2.y - line->o.y) * line->dy;
+
+	    if (lo > hi)
+	    {
+		t0 = lo;
+		lo = hi;
+		hi = t0;
+	    }
+
+	    lo += PVS_MARGIN;
+	    hi -= PVS_MARGIN;
+
+	    if (lo >= hi)
+		continue;
+
+	    for (j=numpieces-1 ; j>=0 ; j--)
+	    {
+		if (hi <= pieces[j][0] || lo >= pieces[j][1])
+		    continue;
+
+		if (lo > pieces[j][0] && hi < pieces[j][1])
+		{
+		    // leave the piece whole rather than lose an opening
+		    if (numpieces == PVS_MAXPIECES)
+			continue;
+
+		    pieces[numpieces][0] = hi;
+		    pieces[numpieces][1] = pieces[j][1];
+		    numpieces++;
+		    pieces[j][1] = lo;
+		}
+		else if (lo > pieces[j][0])
+		    pieces[j][1] = lo;
+		else if (hi < pieces[j][1])
+		    pieces[j][0] = hi;
+		else
+		    pieces[j][0] = pieces[j][1] + 1;
+	    }
+	}
+    }
+
+    for (j=0 ; j<numpieces ; j++)
+    {
+	if (pieces[j][0] > pieces[j][1])
+	    continue;
+
+	v1 = PVS_LinePoint (line, pieces[j][0] - PVS_MARGIN);
+	v2 = PVS_LinePoint (line, pieces[j][1] + PVS_MARGIN);
+
+	// back is behind the partition, so reverse for it
+	PVS_AddPortal (v2, v1, front, back);
+	PVS_AddPortal (v1, v2, back, front);
+    }
+}
+
+
+//
+// PVS_SplitSpan
+// Hands the part t0..t1 of the current partition down a
+//  subtree to the subsectors it borders.
+//
+static void PVS_SplitSpan (pvsline_t *line, int bspnum, double t0, double t1)
+{
+    node_t*	node;
+    pvsline_t	nodeline;
+    pvsspan_t*	span;
+    double	s0;
+    double	s1;
+    double	t;
+
+    if (bspnum & NF_SUBSECTOR)
+    {
+	spans = PVS_Grow (spans, numspans, &maxspans, sizeof(*spans));
+	span = &spans[numspans++];
+	span->leaf = bspnum & ~NF_SUBSECTOR;
+	span->t[0] = t0;
+	span->t[1] = t1;
+	return;
+    }
+
+    node = &nodes[bspnum];
+    PVS_FixedLine (node->x, node->y, node->dx, node->dy, &nodeline);
+    s0 = PVS_Side (&nodeline, PVS_LinePoint (line, t0));
+    s1 = PVS_Side (&nodeline, PVS_LinePoint (line, t1));
+
+    if (fabs (s0) < PVS_EPSILON && fabs (s1) < PVS_EPSILON)
+    {
+	// along this partition too, both sides may touch it
+	PVS_SplitSpan (line, node->children[0], t0, t1);
+	PVS_SplitSpan (line, node->children[1], t0, t1);
+    }
+    else if (s0 <= PVS_EPSILON && s1 <= PVS_EPSILON)
+	PVS_SplitSpan (line, node->children[0], t0, t1);
+    else if (s0 >= -PVS_EPSILON && s1 >= -PVS_EPSILON)
+	PVS_SplitSpan (line, node->children[1], t0, t1);
+    else
+    {
+	t = t0 + (t1 - t0) * s0 / (s0 - s1);
+	PVS_SplitSpan (line, node->children[s0 > 0], t0, t);
+	PVS_SplitSpan (line, node->children[s0 < 0], t, t1);
+    }
+}
+
+
+//
+// PVS_PortalizeNode
+// Walks the BSP carving out each node's cell, and connects the
+//  subsectors on either side of every partition.
+//
+static boolean PVS_PortalizeNode (int bspnum, int depth, int count)
+{
+    node_t*	node;
+    pvspoint_t*	poly;
+    pvsline_t	line;
+    pvsline_t	edge;
+    double	area;
+    double	t0;
+    double	t1;
+    int		i;
+    int		j;
+    int		numfront;
+    int		side;
+    int		n;
+
+    if (bspnum & NF_SUBSECTOR)
+	return true;
+
+    if (depth + 1 >= PVS_MAXDEPTH)
+	return false;
+
+    node = &nodes[bspnum];
+    poly = polys + depth * PVS_MAXPOLY;
+    PVS_FixedLine (node->x, node->y, node->dx, node->dy, &line);
+
+    // the partition within this cell
+    area = 0;
+    for (i=0 ; i<count ; i++)
+    {
+	j = (i+1) % count;
+	area += poly[i].x * poly[j].y - poly[j].x * poly[i].y;
+    }
+
+    t0 = -131072;
+    t1 = 131072;
+
+    for (i=0 ; i<count ; i++)
+    {
+	if (!PVS_MakeLine (poly[i], poly[(i+1) % count], &edge))
+	    continue;
+
+	// inside is to the left of a counterclockwise edge
+	if (area < 0)
+	{
+	    edge.dx = -edge.dx;
+	    edge.dy = -edge.dy;
+	}
+
+	if (!PVS_ClipRange (PVS_Side (&edge, line.o),
+			    edge.dx * line.dy - edge.dy * line.dx,
+			    &t0, &t1))
+	    break;
+    }
+
+    if (i == count)
+    {
+	numspans = 0;
+	PVS_SplitSpan (&line, node->children[0], t0, t1);
+	numfront = numspans;
+	PVS_SplitSpan (&line, node->children[1], t0, t1);
+
+	for (i=0 ; i<numfront ; i++)
+	{
+	    for (j=numfront ; j<numspans ; j++)
+	    {
+		t0 = spans[i].t[0] > spans[j].t[0] ? spans[i].t[0] : spans[j].t[0];
+		t1 = spans[i].t[1] < spans[j].t[1] ? spans[i].t[1] : spans[j].t[1];
+
+		if (t0 <= t1 && spans[i].leaf != spans[j].leaf)
+		    PVS_AddPortalPair (&line, spans[i].leaf, spans[j].leaf,
+				       t0, t1);
+	    }
+	}
+    }
+
+    for (side=0 ; side<2 ; side++)
+    {
+	n = PVS_ClipPoly (poly, count, poly + PVS_MAXPOLY, &line,
+			  side ? 1 : -1);
+
+	if (n < 0)
+	    return false;
+
+	if (n >= 3 && !PVS_PortalizeNode (node->children[side], depth+1, n))
+	    return false;
+    }
+
+    return true;
+}
+
+
+//
+// PVS_Flood
+// Marks every subsector reachable from leaf through portals.
+//  The row may already hold part of a flow, so the walk keeps
+//  its own marks in seen, which is left clear again.
+//
+static void PVS_Flood (int leaf, byte *row, byte *seen, int *queue)
+{
+    int		head;
+    int		tail;
+    int		next;
+    int		i;
+
+    head = tail = 0;
+    queue[tail++] = leaf;
+    seen[leaf] = 1;
+
+    while (head < tail)
+    {
+	leaf = queue[head++];
+	row[leaf>>3] |= 1 << (leaf&7);
+
+	for (i=firstportal[leaf] ; i<firstportal[leaf+1] ; i++)
+	{
+	    next = portals[i].leaf;
+
+	    if (!seen[next])
+	    {
+		seen[next] = 1;
+		queue[tail++] = next;
+	    }
+	}
+    }
+
+    while (tail > 0)
+	seen[queue[--tail]] = 0;
+}
+
+
+//
+// PVS_Flow
+// Marks the subsectors a line starting in leaf can reach.
+//
+static void PVS_Flow (int leaf, byte *row, pvsflow_t *stack,
+		      byte *onpath, int *queue)
+{
+    int		depth;
+    int		visits;
+    int		i;
+    pvsflow_t*	flow;
+    pvsportal_t* portal;
+    pvspoint_t	source[2];
+    pvspoint_t	target[2];
+    pvsline_t	pass;
+
+    row[leaf>>3] |= 1 << (leaf&7);
+    onpath[leaf] = 1;
+    visits = 0;
+
+    for (i=firstportal[leaf] ; i<firstportal[leaf+1] ; i++)
+    {
+	portal = &portals[i];
+	row[portal->leaf>>3] |= 1 << (portal->leaf&7);
+
+	flow = &stack[0];
+	flow->leaf = portal->leaf;
+	flow->next = firstportal[portal->leaf];
+	flow->source[0] = flow->pass[0] = portal->p[0];
+	flow->source[1] = flow->pass[1] = portal->p[1];
+	onpath[flow->leaf] = 1;
+	depth = 1;
+
+	while (depth > 0)
+	{
+	    flow = &stack[depth-1];
+
+	    if (flow->next == firstportal[flow->leaf+1])
+	    {
+		onpath[flow->leaf] = 0;
+		depth--;
+		continue;
+	    }
+
+	    portal = &portals[flow->next++];
+
+	    if (onpath[portal->leaf])
+		continue;
+
+	    if (++visits > PVS_FLOWLIMIT || depth == PVS_MAXFLOW)
+	    {
+		// too much to follow, settle for reachability
+		while (depth > 0)
+		    onpath[stack[--depth].leaf] = 0;
+		onpath[leaf] = 0;
+		PVS_Flood (leaf, row, onpath, queue);
+		return;
+	    }
+
+	    // only the part beyond the pass portal
+	    target[0] = portal->p[0];
+	    target[1] = portal->p[1];
+
+	    if (PVS_MakeLine (flow->pass[0], flow->pass[1], &pass)
+	     && !PVS_ClipSegment (target, &pass, -1))
+		continue;
+
+	    if (!PVS_ClipSeparators (flow->source, flow->pass, target))
+		continue;
+
+	    // and the part of the source that can see it
+	    source[0] = flow->source[0];
+	    source[1] = flow->source[1];
+
+	    if (!PVS_ClipSeparators (target, flow->pass, source))
+		continue;
+
+	    row[portal->leaf>>3] |= 1 << (portal->leaf&7);
+
+	    flow = &stack[depth++];
+	    flow->leaf = portal->leaf;
+	    flow->next = firstportal[portal->leaf];
+	    flow->source[0] = source[0];
+	    flow->source[1] = source[1];
+	    flow->pass[0] = target[0];
+	    flow->pass[1] = target[1];
+	    onpath[flow->leaf] = 1;
+	}
+    }
+
+    onpath[leaf] = 0;
+}
+
+
+//
+// PVS_Build
+// Returns the number of portals, or -1 if the map is beyond
+//  the builder's limits.
+//
+static int PVS_Build (void)
+{
+    int		i;
+    int		j;
+    byte*	onpath;
+    int*	queue;
+    pvsflow_t*	stack;
+    pvsportal_t* sorted;
+
+    polys = Z_Malloc (PVS_MAXDEPTH * PVS_MAXPOLY * sizeof(*polys),
+		      PU_STATIC, NULL);
+
+    // start from the map bounds with some room to spare
+    polys[0].x = (double) pvsbbox[BOXLEFT] / FRACUNIT - 64;
+    polys[0].y = (double) pvsbbox[BOXBOTTOM] / FRACUNIT - 64;
+    polys[1].x = (double) pvsbbox[BOXRIGHT] / FRACUNIT + 64;
+    polys[1].y = polys[0].y;
+    polys[2].x = polys[1].x;
+    polys[2].y = (double) pvsbbox[BOXTOP] / FRACUNIT + 64;
+    polys[3].x = polys[0].x;
+    polys[3].y = polys[2].y;
+
+    portals = NULL;
+    numportals = maxportals = 0;
+    spans = NULL;
+    numspans = maxspans = 0;
+
+    i = PVS_PortalizeNode (numnodes-1, 0, 4);
+
+    Z_Free (polys);
+    if (spans != NULL)
+	Z_Free (spans);
+
+    if (!i || numportals == 0)
+    {
+	if (portals != NULL)
+	    Z_Free (portals);
+	return -1;
+    }
+
+    // group the portals by the subsector they lead out of
+    firstportal = Z_Malloc ((numsubsectors+1) * sizeof(*firstportal),
+			    PU_STATIC, NULL);
+    memset (firstportal, 0, (numsubsectors+1) * sizeof(*firstportal));
+
+    for (i=0 ; i<numportals ; i++)
+	firstportal[portals[i].from]++;
+
+    for (i=1 ; i<numsubsectors ; i++)
+	firstportal[i] += firstportal[i-1];
+
+    firstportal[numsubsectors] = numportals;
+    sorted = Z_Malloc (numportals * sizeof(*sorted), PU_STATIC, NULL);
+
+    // filling each bucket from its end leaves its start behind
+    for (i=numportals-1 ; i>=0 ; i--)
+	sorted[--firstportal[portals[i].from]] = portals[i];
+
+    Z_Free (portals);
+    portals = sorted;
+
+    onpath = Z_Malloc (numsubsectors, PU_STATIC, NULL);
+    memset (onpath, 0, numsubsectors);
+    queue = Z_Malloc (numsubsectors * sizeof(*queue), PU_STATIC, NULL);
+    stack = Z_Malloc (PVS_MAXFLOW * sizeof(*stack), PU_STATIC, NULL);
+
+    memset (sightpvs, 0, numsubsectors * sightpvsrowbytes);
+
+    for (i=0 ; i<numsubsectors ; i++)
+	PVS_Flow (i, sightpvs + i * sightpvsrowbytes, stack, onpath, queue);
+
+    // sight is symmetric, so keep either direction's answer
+    for (i=0 ; i<numsubsectors ; i++)
+    {
+	for (j=i+1 ; j<numsubsectors ; j++)
+	{
+	    if (sightpvs[i*sightpvsrowbytes + (j>>3)] & (1 << (j&7)))
+		sightpvs[j*sightpvsrowbytes + (i>>3)] |= 1 << (i&7);
+	    else if (sightpvs[j*sightpvsrowbytes + (i>>3)] & (1 << (i&7)))
+		sightpvs[i*sightpvsrowbytes + (j>>3)] |= 1 << (j&7);
+	}
+    }
+
+    Z_Free (stack);
+    Z_Free (queue);
+    Z_Free (onpath);
+    Z_Free (firstportal);
+    Z_Free (portals);
+
+    return numportals;
+}
+
+
+//
+// PVS_FillHeader
+//
+static void PVS_FillHeader (pvsheader_t *header, int lumpnum)
+{
+    memset (header, 0, sizeof(*header));
+    memcpy (header->magic, "UDSIGPVS", sizeof(header->magic));
+    header->version = PVS_FILEVERSION;
+    W_Checksum (header->digest);
+    header->lumpnum = lumpnum;
+    header->numsubsectors = numsubsectors;
+    header->numnodes = numnodes;
+    header->numsegs = numsegs;
+}
+
+
+//
+// PVS_Load
+//
+static boolean PVS_Load (char *filename, int lumpnum, int length)
+{
+    pvsheader_t	header;
+    pvsheader_t	expected;
+    FILE*	handle;
+    boolean	result;
+
+    handle = fopen (filename, "rb");
+
+    if (handle == NULL)
+	return false;
+
+    PVS_FillHeader (&expected, lumpnum);
+
+    result = fread (&header, sizeof(header), 1, handle) == 1
+	  && !memcmp (&header, &expected, sizeof(header))
+	  && fread (sightpvs, 1, length, handle) == length;
+
+    fclose (handle);
+    return result;
+}
+
+
+//
+// PVS_Save
+//
+static void PVS_Save (char *filename, int lumpnum, int length)
+{
+    pvsheader_t	header;
+    FILE*	handle;
+    boolean	result;
+
+    PVS_FillHeader (&header, lumpnum);
+    handle = fopen (filename, "wb");
+
+    if (handle == NULL)
+    {
+	printf ("P_InitSightPVS: couldn't write %s\n", filename);
+	return;
+    }
+
+    result = fwrite (&header, sizeof(header), 1, handle) == 1
+	  && fwrite (sightpvs, 1, length, handle) == length;
+
+    fclose (handle);
+
+    if (!result)
+	printf ("P_InitSightPVS: couldn't write %s\n", filename);
+}
+
+
+//
+// P_InitSightPVS
+// Loads or builds the sight PVS of the level just loaded.
+// Must be called after P_GroupLines.
+//
+void P_InitSightPVS (char *lumpname, int lumpnum)
+{
+    char*	filename;
+    char*	how;
+    int		length;
+    int		starttime;
+    int		visible;
+    int		i;
+    int		j;
+
+    sightpvs = NULL;
+
+    //!
+    // @category obscure
+    //
+    // Check every sight check the visibility set rejects against the
+    // exact trace and report any that disagree. Implies -sightpvs.
+    //
+
+    sightpvscheck = M_ParmExists ("-checkpvs");
+
+    //!
+    // @category obscure
+    //
+    // Build a subsector visibility set for each level and use it to
+    // skip sight checks that can't succeed.
+    //
+
+    if (!M_ParmExists ("-sightpvs") && !sightpvscheck)
+	return;
+
+    if (numnodes == 0)
+	return;
+
+    sightpvsrowbytes = (numsubsectors + 7) / 8;
+    length = numsubsectors * sightpvsrowbytes;
+
+    if (length > Z_FreeMemory () / 4)
+    {
+	printf ("P_InitSightPVS: %s: %i KB won't fit\n", lumpname, length >> 10);
+	return;
+    }
+
+    M_ClearBox (pvsbbox);
+    for (i=0 ; i<numvertexes ; i++)
+	M_AddToBox (pvsbbox, vertexes[i].x, vertexes[i].y);
+
+    starttime = I_GetTimeMS ();
+    sightpvs = Z_Malloc (length, PU_LEVEL, NULL);
+    filename = M_StringJoin (savegamedir, lumpname, ".pvs", NULL);
+
+    if (PVS_Load (filename, lumpnum, length))
+	how = "loaded";
+    else if (PVS_Build () >= 0)
+    {
+	how = "built";
+	PVS_Save (filename, lumpnum, length);
+    }
+    else
+    {
+	printf ("P_InitSightPVS: %s is too complex\n", lumpname);
+	Z_Free (sightpvs);
+	sightpvs = NULL;
+	free (filename);
+	return;
+    }
+
+    free (filename);
+
+    visible = 0;
+    for (i=0 ; i<numsubsectors ; i++)
+	for (j=0 ; j<numsubsectors ; j++)
+	    visible += (sightpvs[i*sightpvsrowbytes + (j>>3)] >> (j&7)) & 1;
+
+    printf ("P_InitSightPVS: %s: %i subsectors, %i KB, %i%% visible, "
+	    "%s in %i ms\n",
+	    lumpname, numsubsectors, (length + 1023) >> 10,
+	    (int) ((int64_t) visible * 100 / ((int64_t) numsubsectors
+					      * numsubsectors)),
+	    how, I_GetTimeMS () - starttime);
+}
+
+
+//
+// PVS_Inside
+// True if mo is well inside the segs of its subsector, where
+//  the exact trace can't leak past a wall.
+//
+static boolean PVS_Inside (mobj_t *mo)
+{
+    subsector_t*	ss;
+    seg_t*		seg;
+    int64_t		cross;
+    fixed_t		guard;
+    int			dx;
+    int			dy;
+    int			i;
+
+    guard = PVS_GUARD*FRACUNIT;
+
+    if (mo->x < pvsbbox[BOXLEFT] + guard
+     || mo->x > pvsbbox[BOXRIGHT] - guard
+     || mo->y < pvsbbox[BOXBOTTOM] + guard
+     || mo->y > pvsbbox[BOXTOP] - guard)
+	return false;
+
+    ss = mo->subsector;
+    seg = &segs[ss->firstline];
+
+    for (i=ss->numlines ; i ; i--, seg++)
+    {
+	dx = (seg->v2->x - seg->v1->x) >> FRACBITS;
+	dy = (seg->v2->y - seg->v1->y) >> FRACBITS;
+	cross = (int64_t) (mo->y - seg->v1->y) * dx
+	      - (int64_t) (mo->x - seg->v1->x) * dy;
+
+	// in front by at least the guard distance
+	if (cross > -(int64_t) guard * (abs (dx) + abs (dy)))
+	    return false;
+    }
+
+    return true;
+}
+
+
+//
+// PVS_NearPartition
+// True if t1 or t2 is close enough to a partition on the path
+//  to x,y for P_DivlineSide to put it on the wrong side.
+//
+static boolean PVS_NearPartition (fixed_t x, fixed_t y,
+				  mobj_t *t1, mobj_t *t2)
+{
+    node_t*	node;
+    int64_t	band;
+    int64_t	cross;
+    int		nodenum;
+    int		dx;
+    int		dy;
+
+    nodenum = numnodes - 1;
+
+    while (!(nodenum & NF_SUBSECTOR))
+    {
+	node = &nodes[nodenum];
+	dx = node->dx >> FRACBITS;
+	dy = node->dy >> FRACBITS;
+
+	// P_DivlineSide compares x against y on these
+	if (!dy && (t1->x == node->y || t2->x == node->y))
+	    return true;
+
+	band = (int64_t) PVS_GUARD*FRACUNIT * (abs (dx) + abs (dy));
+
+	cross = (int64_t) (t1->y - node->y) * dx
+	      - (int64_t) (t1->x - node->x) * dy;
+	if (cross < band && cross > -band)
+	    return true;
+
+	cross = (int64_t) (t2->y - node->y) * dx
+	      - (int64_t) (t2->x - node->x) * dy;
+	if (cross < band && cross > -band)
+	    return true;
+
+	nodenum = node->children[R_PointOnSide (x, y, node)];
+    }
+
+    return false;
+}
+
+
+//
+// P_SightPVSRejects
+// True if the PVS shows that t1 can't see t2.
+//
+boolean P_SightPVSRejects (mobj_t *t1, mobj_t *t2)
+{
+    int		s1;
+    int		s2;
+
+    s1 = t1->subsector - subsectors;
+    s2 = t2->subsector - subsectors;
+
+    if (sightpvs[s1*sightpvsrowbytes + (s2>>3)] & (1 << (s2&7)))
+	return false;
+
+    // Only where the exact trace is sure to agree. A horizontal
+    // trace has P_DivlineSide compare vertex x against its y, so
+    // it can slip through a vertical line at x == y, and either
+    // flat trace can run exactly along a wall.
+    return t1->x != t2->x && t1->y != t2->y
+	&& PVS_Inside (t1) && PVS_Inside (t2)
+	&& !PVS_NearPartition (t1->x, t1->y, t1, t2)
+	&& !PVS_NearPartition (t2->x, t2->y, t1, t2);
+}
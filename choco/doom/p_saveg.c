@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dstrings.h"
 // #include "deh_main.h"
@@ -40,6 +41,22 @@ FILE *save_stream;
 int savegamelength;
 boolean savegame_error;
 
+// If save_buffer is set, the archivers read and write it instead
+// of save_stream. A buffer being written grows as needed, so it
+// may have moved by the time writing is done.
+
+byte *save_buffer;
+int save_buffer_size;
+int save_offset;
+
+// If savegame_exact is set, the archivers also keep what a
+// savegame throws away: the order of the thinkers, the links and
+// references between mobjs, and full precision heights. A demo
+// then plays on from the restored game as if it had never been
+// stopped. The result is not a valid savegame file.
+
+boolean savegame_exact;
+
 // Get the filename of a temporary file to write the savegame to.  After
 // the file has been successfully saved, it will be renamed to the 
 // real file.
@@ -82,6 +99,24 @@ static byte saveg_read8(void)
 {
     byte result;
 
+    if (save_buffer != NULL)
+    {
+        if (save_offset < save_buffer_size)
+        {
+            return save_buffer[save_offset++];
+        }
+
+        if (!savegame_error)
+        {
+            fprintf(stderr, "saveg_read8: Unexpected end of buffer while "
+                            "reading save game\n");
+
+            savegame_error = true;
+        }
+
+        return 0;
+    }
+
     if (fread(&result, 1, 1, save_stream) < 1)
     {
         if (!savegame_error)
@@ -98,6 +133,23 @@ static byte saveg_read8(void)
 
 static void saveg_write8(byte value)
 {
+    byte *newbuffer;
+
+    if (save_buffer != NULL)
+    {
+        if (save_offset == save_buffer_size)
+        {
+            newbuffer = Z_Malloc(save_buffer_size * 2, PU_STATIC, NULL);
+            memcpy(newbuffer, save_buffer, save_offset);
+            Z_Free(save_buffer);
+            save_buffer = newbuffer;
+            save_buffer_size *= 2;
+        }
+
+        save_buffer[save_offset++] = value;
+        return;
+    }
+
     if (fwrite(&value, 1, 1, save_stream) < 1)
     {
         if (!savegame_error)
@@ -145,6 +197,16 @@ static void saveg_write32(int value)
     saveg_write8((value >> 24) & 0xff);
 }
 
+static long saveg_tell(void)
+{
+    if (save_buffer != NULL)
+    {
+        return save_offset;
+    }
+
+    return ftell(save_stream);
+}
+
 // Pad to 4-byte boundaries
 
 static void saveg_read_pad(void)
@@ -153,7 +215,7 @@ static void saveg_read_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = saveg_tell();
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -169,7 +231,7 @@ static void saveg_write_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = saveg_tell();
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -297,6 +359,9 @@ static void saveg_write_thinker_t(thinker_t *str)
 //
 // mobj_t
 //
+// Read and written in the vanilla field order, which is not the
+// order of the in-memory struct.
+//
 
 static void saveg_read_mobj_t(mobj_t *str)
 {
@@ -1340,6 +1405,49 @@ static void saveg_write_glow_t(glow_t *str)
     saveg_write32(str->direction);
 }
 
+//
+// fireflicker_t
+//
+
+static void saveg_read_fireflicker_t(fireflicker_t *str)
+{
+    int sector;
+
+    // thinker_t thinker;
+    saveg_read_thinker_t(&str->thinker);
+
+    // sector_t* sector;
+    sector = saveg_read32();
+    str->sector = &sectors[sector];
+
+    // int count;
+    str->count = saveg_read32();
+
+    // int maxlight;
+    str->maxlight = saveg_read32();
+
+    // int minlight;
+    str->minlight = saveg_read32();
+}
+
+static void saveg_write_fireflicker_t(fireflicker_t *str)
+{
+    // thinker_t thinker;
+    saveg_write_thinker_t(&str->thinker);
+
+    // sector_t* sector;
+    saveg_write32(str->sector - sectors);
+
+    // int count;
+    saveg_write32(str->count);
+
+    // int maxlight;
+    saveg_write32(str->maxlight);
+
+    // int minlight;
+    saveg_write32(str->minlight);
+}
+
 //
 // Write the header for a savegame
 //
@@ -1473,7 +1581,10 @@ void P_UnArchivePlayers (void)
 	// will be set when unarc thinker
 	players[i].mo = NULL;	
 	players[i].message = NULL;
-	players[i].attacker = NULL;
+
+	// swizzled by P_RelinkMobjs
+	if (!savegame_exact)
+	    players[i].attacker = NULL;
     }
 }
 
@@ -1492,8 +1603,17 @@ void P_ArchiveWorld (void)
     // do sectors
     for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
     {
-	saveg_write16(sec->floorheight >> FRACBITS);
-	saveg_write16(sec->ceilingheight >> FRACBITS);
+	if (savegame_exact)
+	{
+	    saveg_write32(sec->floorheight);
+	    saveg_write32(sec->ceilingheight);
+	    saveg_writep(sec->soundtarget);
+	}
+	else
+	{
+	    saveg_write16(sec->floorheight >> FRACBITS);
+	    saveg_write16(sec->ceilingheight >> FRACBITS);
+	}
 	saveg_write16(sec->floorpic);
 	saveg_write16(sec->ceilingpic);
 	saveg_write16(sec->lightlevel);
@@ -1515,8 +1635,16 @@ void P_ArchiveWorld (void)
 	    
 	    si = &sides[li->sidenum[j]];
 
-	    saveg_write16(si->textureoffset >> FRACBITS);
-	    saveg_write16(si->rowoffset >> FRACBITS);
+	    if (savegame_exact)
+	    {
+		saveg_write32(si->textureoffset);
+		saveg_write32(si->rowoffset);
+	    }
+	    else
+	    {
+		saveg_write16(si->textureoffset >> FRACBITS);
+		saveg_write16(si->rowoffset >> FRACBITS);
+	    }
 	    saveg_write16(si->toptexture);
 	    saveg_write16(si->bottomtexture);
 	    saveg_write16(si->midtexture);	
@@ -1540,15 +1668,24 @@ void P_UnArchiveWorld (void)
     // do sectors
     for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
     {
-	sec->floorheight = saveg_read16() << FRACBITS;
-	sec->ceilingheight = saveg_read16() << FRACBITS;
+	if (savegame_exact)
+	{
+	    sec->floorheight = saveg_read32();
+	    sec->ceilingheight = saveg_read32();
+	    sec->soundtarget = saveg_readp();	// swizzled by P_RelinkMobjs
+	}
+	else
+	{
+	    sec->floorheight = saveg_read16() << FRACBITS;
+	    sec->ceilingheight = saveg_read16() << FRACBITS;
+	    sec->soundtarget = 0;
+	}
 	sec->floorpic = saveg_read16();
 	sec->ceilingpic = saveg_read16();
 	sec->lightlevel = saveg_read16();
 	sec->special = saveg_read16();		// needed?
 	sec->tag = saveg_read16();		// needed?
 	sec->specialdata = 0;
-	sec->soundtarget = 0;
     }
     
     // do lines
@@ -1562,8 +1699,16 @@ void P_UnArchiveWorld (void)
 	    if (li->sidenum[j] == -1)
 		continue;
 	    si = &sides[li->sidenum[j]];
-	    si->textureoffset = saveg_read16() << FRACBITS;
-	    si->rowoffset = saveg_read16() << FRACBITS;
+	    if (savegame_exact)
+	    {
+		si->textureoffset = saveg_read32();
+		si->rowoffset = saveg_read32();
+	    }
+	    else
+	    {
+		si->textureoffset = saveg_read16() << FRACBITS;
+		si->rowoffset = saveg_read16() << FRACBITS;
+	    }
 	    si->toptexture = saveg_read16();
 	    si->bottomtexture = saveg_read16();
 	    si->midtexture = saveg_read16();
@@ -1581,17 +1726,169 @@ void P_UnArchiveWorld (void)
 typedef enum
 {
     tc_end,
-    tc_mobj
+    tc_mobj,
+    tc_special		// exact only: a special, in line with the mobjs
 
 } thinkerclass_t;
 
 
+//
+// P_ArchiveSpecials
+//
+enum
+{
+    tc_ceiling,
+    tc_door,
+    tc_floor,
+    tc_plat,
+    tc_flash,
+    tc_strobe,
+    tc_glow,
+    tc_endspecials,
+    tc_fireflicker	// exact only: vanilla savegames lose these
+
+} specials_e;	
+
+
+static int P_SpecialClass (thinker_t* th);
+static void P_ArchiveSpecial (thinker_t* th, int tclass);
+static void P_UnArchiveSpecial (byte tclass);
+
+
+//
+// Mobj references in an exact archive are the addresses the mobjs
+// had when it was written. Each mobj is followed by its own old
+// address, and once all are read the references are looked up in
+// a table sorted by old address.
+//
+typedef struct
+{
+    void*	address;
+    mobj_t*	mobj;
+
+} mobjaddress_t;
+
+static mobjaddress_t*	mobjaddresses;
+static int		nummobjaddresses;
+
+
+static int P_CompareMobjAddresses (const void* a, const void* b)
+{
+    const mobjaddress_t*	ma = a;
+    const mobjaddress_t*	mb = b;
+
+    if (ma->address < mb->address)
+	return -1;
+
+    return ma->address > mb->address;
+}
+
+
+static mobj_t* P_MobjForAddress (void* address)
+{
+    mobjaddress_t	key;
+    mobjaddress_t*	found;
+
+    if (address == NULL)
+	return NULL;
+
+    key.address = address;
+    found = bsearch (&key, mobjaddresses, nummobjaddresses,
+		     sizeof(*mobjaddresses), P_CompareMobjAddresses);
+
+    // a reference to a mobj that was already removed
+    if (found == NULL)
+	return NULL;
+
+    return found->mobj;
+}
+
+
+//
+// P_RelinkMobjs
+// Swizzles the mobj references of an exact archive and rebuilds the
+// sector and blockmap lists in the order they had.
+//
+static void P_RelinkMobjs (void)
+{
+    int		i;
+    int		blockx;
+    int		blocky;
+    mobj_t*	mobj;
+
+    qsort (mobjaddresses, nummobjaddresses, sizeof(*mobjaddresses),
+	   P_CompareMobjAddresses);
+
+    for (i=0 ; i<numsectors ; i++)
+	sectors[i].thinglist = NULL;
+
+    memset (blocklinks, 0, bmapwidth*bmapheight*sizeof(*blocklinks));
+
+    for (i=0 ; i<nummobjaddresses ; i++)
+    {
+	mobj = mobjaddresses[i].mobj;
+
+	mobj->target = P_MobjForAddress (mobj->target);
+	mobj->tracer = P_MobjForAddress (mobj->tracer);
+	mobj->snext = P_MobjForAddress (mobj->snext);
+	mobj->sprev = P_MobjForAddress (mobj->sprev);
+	mobj->bnext = P_MobjForAddress (mobj->bnext);
+	mobj->bprev = P_MobjForAddress (mobj->bprev);
+
+	// the first mobj of each list is its head
+	if (!(mobj->flags & MF_NOSECTOR) && mobj->sprev == NULL)
+	    mobj->subsector->sector->thinglist = mobj;
+
+	if (!(mobj->flags & MF_NOBLOCKMAP) && mobj->bprev == NULL)
+	{
+	    blockx = (mobj->x - bmaporgx)>>MAPBLOCKSHIFT;
+	    blocky = (mobj->y - bmaporgy)>>MAPBLOCKSHIFT;
+
+	    if (blockx>=0
+		&& blockx < bmapwidth
+		&& blocky>=0
+		&& blocky < bmapheight)
+	    {
+		blocklinks[blocky*bmapwidth+blockx] = mobj;
+	    }
+	}
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	if (playeringame[i])
+	    players[i].attacker = P_MobjForAddress (players[i].attacker);
+
+    for (i=0 ; i<numsectors ; i++)
+	sectors[i].soundtarget = P_MobjForAddress (sectors[i].soundtarget);
+
+    for (i=0 ; i<numbraintargets ; i++)
+	braintargets[i] = P_MobjForAddress (braintargets[i]);
+
+    Z_Free (mobjaddresses);
+    mobjaddresses = NULL;
+}
+
+
 //
 // P_ArchiveThinkers
 //
 void P_ArchiveThinkers (void)
 {
     thinker_t*		th;
+    int			tclass;
+    int			count;
+    int			i;
+
+    if (savegame_exact)
+    {
+	// the reader sizes its address table from this
+	count = 0;
+	for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+	    if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+		count++;
+
+	saveg_write32(count);
+    }
 
     // save off the current thinkers
     for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
@@ -1602,6 +1899,22 @@ void P_ArchiveThinkers (void)
 	    saveg_write_pad();
             saveg_write_mobj_t((mobj_t *) th);
 
+	    if (savegame_exact)
+		saveg_writep(th);
+
+	    continue;
+	}
+
+	// an exact archive keeps the specials in thinker order
+	if (savegame_exact)
+	{
+	    tclass = P_SpecialClass (th);
+
+	    if (tclass != -1)
+	    {
+		saveg_write8(tc_special);
+		P_ArchiveSpecial (th, tclass);
+	    }
 	    continue;
 	}
 		
@@ -1610,6 +1923,16 @@ void P_ArchiveThinkers (void)
 
     // add a terminating marker
     saveg_write8(tc_end);
+
+    if (savegame_exact)
+    {
+	// the boss brain's spawn spots, swizzled by P_RelinkMobjs
+	saveg_write32(numbraintargets);
+	saveg_write32(braintargeton);
+
+	for (i=0 ; i<numbraintargets ; i++)
+	    saveg_writep(braintargets[i]);
+    }
 }
 
 
@@ -1623,21 +1946,31 @@ void P_UnArchiveThinkers (void)
     thinker_t*		currentthinker;
     thinker_t*		next;
     mobj_t*		mobj;
+    int			i;
     
-    // remove all the current thinkers
+    // free all the current thinkers
+    // (not P_RemoveMobj, which would only mark them removed and
+    // put the items on the respawn queue)
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
 	next = currentthinker->next;
 	
 	if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
-	    P_RemoveMobj ((mobj_t *)currentthinker);
+	    P_FreeMobj ((mobj_t *)currentthinker);
 	else
 	    Z_Free (currentthinker);
 
 	currentthinker = next;
     }
     P_InitThinkers ();
+
+    if (savegame_exact)
+    {
+	nummobjaddresses = 0;
+	mobjaddresses = Z_Malloc ((saveg_read32() + 1)*sizeof(*mobjaddresses),
+				  PU_STATIC, NULL);
+    }
     
     // read in saved thinkers
     while (1)
@@ -1646,6 +1979,16 @@ void P_UnArchiveThinkers (void)
 	switch (tclass)
 	{
 	  case tc_end:
+	    if (savegame_exact)
+	    {
+		numbraintargets = saveg_read32();
+		braintargeton = saveg_read32();
+
+		for (i=0 ; i<numbraintargets ; i++)
+		    braintargets[i] = saveg_readp();
+
+		P_RelinkMobjs ();
+	    }
 	    return; 	// end of list
 			
 	  case tc_mobj:
@@ -1653,14 +1996,31 @@ void P_UnArchiveThinkers (void)
 	    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
             saveg_read_mobj_t(mobj);
 
-	    mobj->target = NULL;
-            mobj->tracer = NULL;
-	    P_SetThingPosition (mobj);
+	    if (savegame_exact)
+	    {
+		// links and references are fixed up at the end
+		mobjaddresses[nummobjaddresses].address = saveg_readp();
+		mobjaddresses[nummobjaddresses].mobj = mobj;
+		nummobjaddresses++;
+
+		mobj->subsector = R_PointInSubsector (mobj->x, mobj->y);
+	    }
+	    else
+	    {
+		mobj->target = NULL;
+		mobj->tracer = NULL;
+		P_SetThingPosition (mobj);
+		mobj->floorz = mobj->subsector->sector->floorheight;
+		mobj->ceilingz = mobj->subsector->sector->ceilingheight;
+	    }
 	    mobj->info = &mobjinfo[mobj->type];
-	    mobj->floorz = mobj->subsector->sector->floorheight;
-	    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 	    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	    P_AddThinker (&mobj->thinker);
+	    P_LinkMobjLists (mobj);
+	    break;
+
+	  case tc_special:
+	    P_UnArchiveSpecial (saveg_read8());
 	    break;
 
 	  default:
@@ -1672,24 +2032,6 @@ void P_UnArchiveThinkers (void)
 }
 
 
-//
-// P_ArchiveSpecials
-//
-enum
-{
-    tc_ceiling,
-    tc_door,
-    tc_floor,
-    tc_plat,
-    tc_flash,
-    tc_strobe,
-    tc_glow,
-    tc_endspecials
-
-} specials_e;	
-
-
-
 //
 // Things to handle:
 //
@@ -1700,99 +2042,147 @@ enum
 // T_StrobeFlash, (strobe_t: sector_t *),
 // T_Glow, (glow_t: sector_t *),
 // T_PlatRaise, (plat_t: sector_t *), - active list
+// T_FireFlicker, (fireflicker_t: sector_t *), - exact only
+//
+
 //
+// P_SpecialClass
+// Returns the class a special thinker is archived as,
+// or -1 if it is not archived.
+//
+static int P_SpecialClass (thinker_t* th)
+{
+    int		i;
+
+    if (th->function.acv == (actionf_v)NULL)
+    {
+	for (i = 0; i < MAXCEILINGS;i++)
+	    if (activeceilings[i] == (ceiling_t *)th)
+		return tc_ceiling;
+
+	// Plats in stasis are lost from savegames, but not from
+	// an exact archive.
+	if (savegame_exact)
+	{
+	    for (i = 0; i < MAXPLATS;i++)
+		if (activeplats[i] == (plat_t *)th)
+		    return tc_plat;
+	}
+
+	return -1;
+    }
+
+    if (th->function.acp1 == (actionf_p1)T_MoveCeiling)
+	return tc_ceiling;
+
+    if (th->function.acp1 == (actionf_p1)T_VerticalDoor)
+	return tc_door;
+
+    if (th->function.acp1 == (actionf_p1)T_MoveFloor)
+	return tc_floor;
+
+    if (th->function.acp1 == (actionf_p1)T_PlatRaise)
+	return tc_plat;
+
+    if (th->function.acp1 == (actionf_p1)T_LightFlash)
+	return tc_flash;
+
+    if (th->function.acp1 == (actionf_p1)T_StrobeFlash)
+	return tc_strobe;
+
+    if (th->function.acp1 == (actionf_p1)T_Glow)
+	return tc_glow;
+
+    // Fire flickers call P_Random, so a demo needs them back.
+    if (savegame_exact
+     && th->function.acp1 == (actionf_p1)T_FireFlicker)
+	return tc_fireflicker;
+
+    return -1;
+}
+
+
+static void P_ArchiveSpecial (thinker_t* th, int tclass)
+{
+    saveg_write8(tclass);
+    saveg_write_pad();
+
+    switch (tclass)
+    {
+      case tc_ceiling:
+	saveg_write_ceiling_t((ceiling_t *) th);
+	break;
+
+      case tc_door:
+	saveg_write_vldoor_t((vldoor_t *) th);
+	break;
+
+      case tc_floor:
+	saveg_write_floormove_t((floormove_t *) th);
+	break;
+
+      case tc_plat:
+	saveg_write_plat_t((plat_t *) th);
+	break;
+
+      case tc_flash:
+	saveg_write_lightflash_t((lightflash_t *) th);
+	break;
+
+      case tc_strobe:
+	saveg_write_strobe_t((strobe_t *) th);
+	break;
+
+      case tc_glow:
+	saveg_write_glow_t((glow_t *) th);
+	break;
+
+      case tc_fireflicker:
+	saveg_write_fireflicker_t((fireflicker_t *) th);
+	break;
+    }
+}
+
+
 void P_ArchiveSpecials (void)
 {
     thinker_t*		th;
+    int			tclass;
     int			i;
 	
     // save off the current thinkers
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    // (an exact archive has them in with the mobjs)
+    if (!savegame_exact)
     {
-	if (th->function.acv == (actionf_v)NULL)
-	{
-	    for (i = 0; i < MAXCEILINGS;i++)
-		if (activeceilings[i] == (ceiling_t *)th)
-		    break;
-	    
-	    if (i<MAXCEILINGS)
-	    {
-                saveg_write8(tc_ceiling);
-		saveg_write_pad();
-                saveg_write_ceiling_t((ceiling_t *) th);
-	    }
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_MoveCeiling)
-	{
-            saveg_write8(tc_ceiling);
-	    saveg_write_pad();
-            saveg_write_ceiling_t((ceiling_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_VerticalDoor)
+	for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
 	{
-            saveg_write8(tc_door);
-	    saveg_write_pad();
-            saveg_write_vldoor_t((vldoor_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_MoveFloor)
-	{
-            saveg_write8(tc_floor);
-	    saveg_write_pad();
-            saveg_write_floormove_t((floormove_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_PlatRaise)
-	{
-            saveg_write8(tc_plat);
-	    saveg_write_pad();
-            saveg_write_plat_t((plat_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_LightFlash)
-	{
-            saveg_write8(tc_flash);
-	    saveg_write_pad();
-            saveg_write_lightflash_t((lightflash_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_StrobeFlash)
-	{
-            saveg_write8(tc_strobe);
-	    saveg_write_pad();
-            saveg_write_strobe_t((strobe_t *) th);
-	    continue;
-	}
-			
-	if (th->function.acp1 == (actionf_p1)T_Glow)
-	{
-            saveg_write8(tc_glow);
-	    saveg_write_pad();
-            saveg_write_glow_t((glow_t *) th);
-	    continue;
+	    tclass = P_SpecialClass (th);
+
+	    if (tclass != -1)
+		P_ArchiveSpecial (th, tclass);
 	}
     }
 	
     // add a terminating marker
     saveg_write8(tc_endspecials);
 
+    // the deathmatch item respawn queue, oldest first
+    if (savegame_exact)
+    {
+	saveg_write32(iquetail);
+	saveg_write32(iquehead);
+
+	for (i = iquetail ; i != iquehead ; i = (i+1)&(ITEMQUESIZE-1))
+	{
+	    saveg_write_mapthing_t(&itemrespawnque[i]);
+	    saveg_write32(itemrespawntime[i]);
+	}
+    }
 }
 
 
-//
-// P_UnArchiveSpecials
-//
-void P_UnArchiveSpecials (void)
+static void P_UnArchiveSpecial (byte tclass)
 {
-    byte		tclass;
     ceiling_t*		ceiling;
     vldoor_t*		door;
     floormove_t*	floor;
@@ -1800,91 +2190,122 @@ void P_UnArchiveSpecials (void)
     lightflash_t*	flash;
     strobe_t*		strobe;
     glow_t*		glow;
-	
+    fireflicker_t*	flick;
+
+    switch (tclass)
+    {
+      case tc_ceiling:
+	saveg_read_pad();
+	ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
+	saveg_read_ceiling_t(ceiling);
+	ceiling->sector->specialdata = ceiling;
+
+	if (ceiling->thinker.function.acp1)
+	    ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
+
+	P_AddThinker (&ceiling->thinker);
+	P_AddActiveCeiling(ceiling);
+	break;
+			    
+      case tc_door:
+	saveg_read_pad();
+	door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
+	saveg_read_vldoor_t(door);
+	door->sector->specialdata = door;
+	door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
+	P_AddThinker (&door->thinker);
+	break;
+			    
+      case tc_floor:
+	saveg_read_pad();
+	floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
+	saveg_read_floormove_t(floor);
+	floor->sector->specialdata = floor;
+	floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
+	P_AddThinker (&floor->thinker);
+	break;
+			    
+      case tc_plat:
+	saveg_read_pad();
+	plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
+	saveg_read_plat_t(plat);
+	plat->sector->specialdata = plat;
+
+	if (plat->thinker.function.acp1)
+	    plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
+
+	P_AddThinker (&plat->thinker);
+	P_AddActivePlat(plat);
+	break;
+			    
+      case tc_flash:
+	saveg_read_pad();
+	flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
+	saveg_read_lightflash_t(flash);
+	flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
+	P_AddThinker (&flash->thinker);
+	break;
+			    
+      case tc_strobe:
+	saveg_read_pad();
+	strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
+	saveg_read_strobe_t(strobe);
+	strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
+	P_AddThinker (&strobe->thinker);
+	break;
+			    
+      case tc_glow:
+	saveg_read_pad();
+	glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
+	saveg_read_glow_t(glow);
+	glow->thinker.function.acp1 = (actionf_p1)T_Glow;
+	P_AddThinker (&glow->thinker);
+	break;
+
+      case tc_fireflicker:
+	saveg_read_pad();
+	flick = Z_Malloc (sizeof(*flick), PU_LEVEL, NULL);
+	saveg_read_fireflicker_t(flick);
+	flick->thinker.function.acp1 = (actionf_p1)T_FireFlicker;
+	P_AddThinker (&flick->thinker);
+	break;
+			    
+      default:
+	I_Error ("P_UnarchiveSpecials:Unknown tclass %i "
+		 "in savegame",tclass);
+    }
+}
+
+
+//
+// P_UnArchiveSpecials
+//
+void P_UnArchiveSpecials (void)
+{
+    byte		tclass;
+    int			i;
 	
     // read in saved thinkers
     while (1)
     {
 	tclass = saveg_read8();
 
-	switch (tclass)
-	{
-	  case tc_endspecials:
-	    return;	// end of list
-			
-	  case tc_ceiling:
-	    saveg_read_pad();
-	    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-            saveg_read_ceiling_t(ceiling);
-	    ceiling->sector->specialdata = ceiling;
-
-	    if (ceiling->thinker.function.acp1)
-		ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
+	if (tclass == tc_endspecials)
+	    break;	// end of list
 
-	    P_AddThinker (&ceiling->thinker);
-	    P_AddActiveCeiling(ceiling);
-	    break;
-				
-	  case tc_door:
-	    saveg_read_pad();
-	    door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-            saveg_read_vldoor_t(door);
-	    door->sector->specialdata = door;
-	    door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
-	    P_AddThinker (&door->thinker);
-	    break;
-				
-	  case tc_floor:
-	    saveg_read_pad();
-	    floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-            saveg_read_floormove_t(floor);
-	    floor->sector->specialdata = floor;
-	    floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
-	    P_AddThinker (&floor->thinker);
-	    break;
-				
-	  case tc_plat:
-	    saveg_read_pad();
-	    plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-            saveg_read_plat_t(plat);
-	    plat->sector->specialdata = plat;
+	P_UnArchiveSpecial (tclass);
+    }
 
-	    if (plat->thinker.function.acp1)
-		plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
+    if (savegame_exact)
+    {
+	iquetail = saveg_read32() & (ITEMQUESIZE-1);
+	iquehead = saveg_read32() & (ITEMQUESIZE-1);
 
-	    P_AddThinker (&plat->thinker);
-	    P_AddActivePlat(plat);
-	    break;
-				
-	  case tc_flash:
-	    saveg_read_pad();
-	    flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-            saveg_read_lightflash_t(flash);
-	    flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
-	    P_AddThinker (&flash->thinker);
-	    break;
-				
-	  case tc_strobe:
-	    saveg_read_pad();
-	    strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-            saveg_read_strobe_t(strobe);
-	    strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
-	    P_AddThinker (&strobe->thinker);
-	    break;
-				
-	  case tc_glow:
-	    saveg_read_pad();
-	    glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-            saveg_read_glow_t(glow);
-	    glow->thinker.function.acp1 = (actionf_p1)T_Glow;
-	    P_AddThinker (&glow->thinker);
-	    break;
-				
-	  default:
-	    I_Error ("P_UnarchiveSpecials:Unknown tclass %i "
-		     "in savegame",tclass);
+	for (i = iquetail ; i != iquehead ; i = (i+1)&(ITEMQUESIZE-1))
+	{
+	    saveg_read_mapthing_t(&itemrespawnque[i]);
+	    itemrespawntime[i] = saveg_read32();
 	}
-	
     }
 
 }
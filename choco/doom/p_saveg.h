@@ -58,5 +58,10 @@ void P_UnArchiveSpecials (void);
 extern FILE *save_stream;
 extern boolean savegame_error;
 
+extern byte *save_buffer;
+extern int save_buffer_size;
+extern int save_offset;
+extern boolean savegame_exact;
+
 
 #endif
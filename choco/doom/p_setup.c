@@ -65,6 +65,7 @@ node_t*		nodes;
 
 int		numlines;
 line_t*		lines;
+linecoll_t*	linecolls;
 
 int		numsides;
 side_t*		sides;
@@ -395,12 +396,14 @@ void P_LoadLineDefs (int lump)
     int			i;
     maplinedef_t*	mld;
     line_t*		ld;
+    linecoll_t*		lc;
     vertex_t*		v1;
     vertex_t*		v2;
 	
     numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
     lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);	
     memset (lines, 0, numlines*sizeof(line_t));
+    linecolls = Z_Malloc (numlines*sizeof(linecoll_t),PU_LEVEL,0);
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
     mld = (maplinedef_t *)data;
@@ -461,6 +464,17 @@ void P_LoadLineDefs (int lump)
 	    ld->backsector = sides[ld->sidenum[1]].sector;
 	else
 	    ld->backsector = 0;
+
+	lc = &linecolls[i];
+	lc->bbox[BOXTOP] = ld->bbox[BOXTOP];
+	lc->bbox[BOXBOTTOM] = ld->bbox[BOXBOTTOM];
+	lc->bbox[BOXLEFT] = ld->bbox[BOXLEFT];
+	lc->bbox[BOXRIGHT] = ld->bbox[BOXRIGHT];
+	lc->x = v1->x;
+	lc->y = v1->y;
+	lc->dx = ld->dx;
+	lc->dy = ld->dy;
+	lc->slopetype = ld->slopetype;
     }
 
     W_ReleaseLumpNum(lump);
@@ -808,6 +822,7 @@ P_SetupLevel
 
     P_GroupLines ();
     P_LoadReject (lumpnum+ML_REJECT);
+    P_InitSightPVS (lumpname, lumpnum);
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
@@ -828,6 +843,9 @@ P_SetupLevel
     // clear special respawning que
     iquehead = iquetail = 0;		
 	
+    // index sectors by tag before any specials look them up
+    P_InitTagLists ();
+
     // set up world state
     P_SpawnSpecials ();
 	
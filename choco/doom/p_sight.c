@@ -18,6 +18,8 @@
 
 
 
+#include <stdio.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -40,6 +42,40 @@ fixed_t		t2y;
 int		sightcounts[2];
 
 
+//
+// SIGHT CACHE
+// Monsters often check the same pair several times in one tic.
+// The BSP traversal depends only on where both things are and on
+// the sector heights, so its result is reused while the positions
+// match. A new tic or a moving plane starts a new generation,
+// which drops every entry.
+//
+#define SIGHTCACHESIZE	64	// power of two
+
+typedef struct
+{
+    mobj_t*	t1;
+    mobj_t*	t2;
+    fixed_t	x1, y1, z1, h1;
+    fixed_t	x2, y2, z2, h2;
+    unsigned	generation;
+    boolean	result;
+
+} sightcache_t;
+
+static sightcache_t	sightcache[SIGHTCACHESIZE];
+static unsigned		sightgeneration = 1;
+
+int		sightcachehits;
+int		sightcachemisses;
+
+
+void P_ClearSightCache (void)
+{
+    sightgeneration++;
+}
+
+
 //
 // P_DivlineSide
 // Returns side 0 (front), 1 (back), or 2 (on).
@@ -307,6 +343,8 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    boolean	pvsrejected;
+    sightcache_t*	sc;
     
     // First check for trivial rejection.
 
@@ -330,6 +368,44 @@ P_CheckSight
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
 
+    // Checked already this tic from the same spots?
+    sc = &sightcache[(((uintptr_t) t1 >> 4) ^ ((uintptr_t) t2 >> 6))
+		     & (SIGHTCACHESIZE-1)];
+
+    if (sc->generation == sightgeneration
+	&& sc->t1 == t1 && sc->t2 == t2
+	&& sc->x1 == t1->x && sc->y1 == t1->y
+	&& sc->z1 == t1->z && sc->h1 == t1->height
+	&& sc->x2 == t2->x && sc->y2 == t2->y
+	&& sc->z2 == t2->z && sc->h2 == t2->height)
+    {
+	sightcachehits++;
+	return sc->result;
+    }
+
+    sightcachemisses++;
+
+    sc->generation = sightgeneration;
+    sc->t1 = t1;
+    sc->t2 = t2;
+    sc->x1 = t1->x;
+    sc->y1 = t1->y;
+    sc->z1 = t1->z;
+    sc->h1 = t1->height;
+    sc->x2 = t2->x;
+    sc->y2 = t2->y;
+    sc->z2 = t2->z;
+    sc->h2 = t2->height;
+
+    // Out of view according to the subsector PVS?
+    pvsrejected = sightpvs != NULL && P_SightPVSRejects (t1, t2);
+
+    if (pvsrejected && !sightpvscheck)
+    {
+	sc->result = false;
+	return false;
+    }
+
     validcount++;
 	
     sightzstart = t1->z + t1->height - (t1->height>>2);
@@ -344,7 +420,18 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    sc->result = P_CrossBSPNode (numnodes-1);
+
+    if (pvsrejected && sc->result)
+    {
+	sightpvsmismatches++;
+	printf ("P_CheckSight: PVS rejected subsectors %i and %i "
+		"(%i so far)\n",
+		(int) (t1->subsector - subsectors),
+		(int) (t2->subsector - subsectors), sightpvsmismatches);
+    }
+
+    return sc->result;
 }
 
 
@@ -446,15 +446,67 @@ P_FindSectorFromLineTag
   int		start )
 {
     int	i;
-	
-    for (i=start+1;i<numsectors;i++)
+
+    if (start < 0)
+	i = sectors[(unsigned) line->tag % numsectors].firsttag;
+    else if (sectors[start].tag == line->tag)
+	i = sectors[start].nexttag;
+    else
+    {
+	// not continuing a chain walk, search the hard way
+	for (i=start+1;i<numsectors;i++)
+	    if (sectors[i].tag == line->tag)
+		return i;
+
+	return -1;
+    }
+
+    // chains are in ascending order, so this returns the same
+    // sector as a linear search from start+1 would
+    for ( ; i >= 0; i = sectors[i].nexttag)
 	if (sectors[i].tag == line->tag)
 	    return i;
-    
+
     return -1;
 }
 
 
+//
+// P_InitTagLists
+// Hash sectors by tag and note the teleport destination of each
+// sector. Must be rerun whenever the thinker list is rebuilt.
+//
+void P_InitTagLists (void)
+{
+    int		i;
+    int		j;
+    mobj_t*	mo;
+    sector_t*	sec;
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+	sectors[i].firsttag = -1;
+	sectors[i].teleportdest = NULL;
+    }
+
+    // insert at the head in reverse, leaving each chain ascending
+    for (i=numsectors-1 ; i>=0 ; i--)
+    {
+	j = (unsigned) sectors[i].tag % numsectors;
+	sectors[i].nexttag = sectors[j].firsttag;
+	sectors[j].firsttag = i;
+    }
+
+    for (mo = mobjtypelist[MT_TELEPORTMAN] ; mo ; mo = mo->tnext)
+    {
+	sec = mo->subsector->sector;
+
+	if (sec->teleportdest == NULL)
+	    sec->teleportdest = mo;
+    }
+}
+
+
 
 
 //
@@ -1376,18 +1428,6 @@ void P_SpawnSpecials (void)
     sector_t*	sector;
     int		i;
 
-    // See if -TIMER was specified.
-
-    if (timelimit > 0 && deathmatch)
-    {
-        levelTimer = true;
-        levelTimeCount = timelimit * 60 * TICRATE;
-    }
-    else
-    {
-	levelTimer = false;
-    }
-
     //	Init special SECTORs.
     sector = sectors;
     for (i=0 ; i<numsectors ; i++, sector++)
@@ -1475,6 +1515,35 @@ void P_SpawnSpecials (void)
 
     
     //	Init other misc stuff
+    P_ClearSpecials ();
+
+    // UNUSED: no horizonal sliders.
+    //	P_InitSlidingDoorFrames();
+}
+
+
+//
+// P_ClearSpecials
+// Restarts the level timer and forgets all active ceilings, plats
+// and switches, as at level start. Also used before a savegame is
+// unarchived over the level that is already loaded.
+//
+void P_ClearSpecials (void)
+{
+    int		i;
+
+    // See if -TIMER was specified.
+
+    if (timelimit > 0 && deathmatch)
+    {
+        levelTimer = true;
+        levelTimeCount = timelimit * 60 * TICRATE;
+    }
+    else
+    {
+	levelTimer = false;
+    }
+
     for (i = 0;i < MAXCEILINGS;i++)
 	activeceilings[i] = NULL;
 
@@ -1483,7 +1552,4 @@ void P_SpawnSpecials (void)
     
     for (i = 0;i < MAXBUTTONS;i++)
 	memset(&buttonlist[i],0,sizeof(button_t));
-
-    // UNUSED: no horizonal sliders.
-    //	P_InitSlidingDoorFrames();
 }
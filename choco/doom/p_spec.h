@@ -40,6 +40,7 @@ void    P_InitPicAnims (void);
 
 // at map load
 void    P_SpawnSpecials (void);
+void    P_ClearSpecials (void);
 
 // every tic
 void    P_UpdateSpecials (void);
@@ -97,6 +98,8 @@ P_FindSectorFromLineTag
 ( line_t*	line,
   int		start );
 
+void P_InitTagLists (void);
+
 int
 P_FindMinSurroundingLight
 ( sector_t*	sector,
@@ -175,6 +178,7 @@ typedef struct
 #define FASTDARK			15
 #define SLOWDARK			35
 
+void    T_FireFlicker (fireflicker_t* flick);
 void    P_SpawnFireFlicker (sector_t* sector);
 void    T_LightFlash (lightflash_t* flash);
 void    P_SpawnLightFlash (sector_t* sector);
@@ -46,6 +46,8 @@ thinker_t	thinkercap;
 void P_InitThinkers (void)
 {
     thinkercap.prev = thinkercap.next  = &thinkercap;
+    thinkercap.aprev = thinkercap.anext = &thinkercap;
+    P_InitMobjLists ();
 }
 
 
@@ -61,6 +63,11 @@ void P_AddThinker (thinker_t* thinker)
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    thinkercap.aprev->anext = thinker;
+    thinker->anext = &thinkercap;
+    thinker->aprev = thinkercap.aprev;
+    thinkercap.aprev = thinker;
 }
 
 
@@ -74,6 +81,44 @@ void P_RemoveThinker (thinker_t* thinker)
 {
   // FIXME: NOP.
   thinker->function.acv = (actionf_v)(-1);
+  P_WakeThinker (thinker);
+}
+
+
+
+//
+// P_WakeThinker
+// Puts a sleeping thinker back in the run list, right after
+// the nearest awake thinker before it. If that is at or past
+// the one running now, it still gets its turn this tic, just
+// as it would have with every thinker visited.
+//
+void P_WakeThinker (thinker_t* thinker)
+{
+    thinker_t*	prev;
+
+    if (thinker->anext)
+	return;
+
+    for (prev = thinker->prev ; !prev->anext ; prev = prev->prev)
+	;
+
+    thinker->aprev = prev;
+    thinker->anext = prev->anext;
+    prev->anext->aprev = thinker;
+    prev->anext = thinker;
+}
+
+
+//
+// P_SleepThinker
+// Takes a thinker out of the run list until P_WakeThinker.
+//
+static void P_SleepThinker (thinker_t* thinker)
+{
+    thinker->aprev->anext = thinker->anext;
+    thinker->anext->aprev = thinker->aprev;
+    thinker->anext = thinker->aprev = NULL;
 }
 
 
@@ -90,27 +135,41 @@ void P_AllocateThinker (thinker_t*	thinker)
 
 //
 // P_RunThinkers
+// Only visits awake thinkers. A thinker that would do nothing
+// until something else changes it (an idle mobj, a ceiling or
+// plat in stasis) is put to sleep after its turn, and the code
+// that changes it wakes it again, so the thinkers that do run
+// keep their exact relative order.
 //
 void P_RunThinkers (void)
 {
     thinker_t *currentthinker, *nextthinker;
 
-    currentthinker = thinkercap.next;
+    currentthinker = thinkercap.anext;
     while (currentthinker != &thinkercap)
     {
 	if ( currentthinker->function.acv == (actionf_v)(-1) )
 	{
 	    // time to remove it
-            nextthinker = currentthinker->next;
+            nextthinker = currentthinker->anext;
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
+	    currentthinker->anext->aprev = currentthinker->aprev;
+	    currentthinker->aprev->anext = currentthinker->anext;
 	    Z_Free(currentthinker);
 	}
 	else
 	{
 	    if (currentthinker->function.acp1)
 		currentthinker->function.acp1 (currentthinker);
-            nextthinker = currentthinker->next;
+            nextthinker = currentthinker->anext;
+
+	    if (!currentthinker->function.acv
+		|| (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker
+		    && P_MobjIsIdle ((mobj_t *) currentthinker)))
+	    {
+		P_SleepThinker (currentthinker);
+	    }
 	}
 	currentthinker = nextthinker;
     }
@@ -138,7 +197,8 @@ void P_Ticker (void)
     {
 	return;
     }
-    
+
+    P_ClearSightCache ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
@@ -17,17 +17,23 @@
 //	generation of lookups, caching, retrieval by name.
 //
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 // #include "deh_main.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "z_zone.h"
 
 
+#include "sha1.h"
+#include "w_checksum.h"
 #include "w_wad.h"
 
 #include "doomdef.h"
+#include "m_argv.h"
 #include "m_misc.h"
 #include "r_local.h"
 #include "p_local.h"
@@ -107,6 +113,7 @@ struct texture_s
 {
     // Keep name for switch changing, etc.
     char	name[8];		
+    uint64_t	key;		// name packed by W_LumpNameKey
     short	width;
     short	height;
 
@@ -151,6 +158,11 @@ short**			texturecolumnlump;
 unsigned short**	texturecolumnofs;
 byte**			texturecomposite;
 
+// Zone tag of the column lookup tables. They are generated on
+//  first use and purgable, unless all of them are generated
+//  at startup (-eagerlookups).
+static int		lookuptag = PU_CACHE;
+
 // for global animation
 int*		flattranslation;
 int*		texturetranslation;
@@ -163,12 +175,49 @@ fixed_t*	spritetopoffset;
 lighttable_t	*colormaps;
 
 
+//
+// STARTUP CACHE
+// The tables derived by R_InitTextures, R_InitSpriteLumps
+//  and R_InitSpriteDefs only depend on the loaded WADs.
+// They are written to a flat file keyed by the checksum
+//  of the WAD directory, so a warm boot loads them with
+//  a single read instead of parsing TEXTURE1/TEXTURE2 and
+//  PNAMES and caching every sprite lump.
+// The column lookups are not stored, they are generated
+//  on first use.
+//
+#define STARTUPCACHE_FILE	"rcache.dat"
+#define STARTUPCACHE_VERSION	2
+
+typedef struct
+{
+    char		magic[8];
+    int			version;
+    int			layout;		// struct sizes of this build
+    sha1_digest_t	digest;		// W_Checksum of the directory
+    int			numtextures;
+    int			numspritelumps;
+    int			numsprites;
+    int			length;		// bytes following the header
+} startupcache_t;
+
+// true if the tables were loaded from the startup cache
+boolean		startupcacheloaded;
+
+static byte*	cachebase;
+static int	cacheofs;
+static int	cachelength;
+
+
 //
 // MAPTEXTURE_T CACHING
 // When a texture is first needed,
 //  it counts the number of composite columns
 //  required in the texture and allocates space
 //  for a column directory and any new columns.
+// The column directory (texturecolumnlump and
+//  texturecolumnofs) is purgable and regenerated
+//  when it is needed again.
 // The directory will simply point inside other patches
 //  if there is only one patch in a given column,
 //  but any columns with multiple patches
@@ -222,6 +271,7 @@ R_DrawColumnInCache
 // Using the texture definition,
 //  the composite texture is created from the patches,
 //  and each column is cached.
+// The column lookup must have been generated.
 //
 void R_GenerateComposite (int texnum)
 {
@@ -239,12 +289,14 @@ void R_GenerateComposite (int texnum)
 	
     texture = textures[texnum];
 
+    // Caching the patches must not purge the column lookup.
+    collump = texturecolumnlump[texnum];
+    colofs = texturecolumnofs[texnum];
+    Z_ChangeTag (collump, PU_STATIC);
+
     block = Z_Malloc (texturecompositesize[texnum],
 		      PU_STATIC, 
 		      &texturecomposite[texnum]);	
-
-    collump = texturecolumnlump[texnum];
-    colofs = texturecolumnofs[texnum];
     
     // Composite the columns together.
     patch = texture->patches;
@@ -284,12 +336,15 @@ void R_GenerateComposite (int texnum)
     // Now that the texture has been built in column cache,
     //  it is purgable from zone memory.
     Z_ChangeTag (block, PU_CACHE);
+    Z_ChangeTag (collump, lookuptag);
 }
 
 
 
 //
 // R_GenerateLookup
+// Fills in the column lump / offset directory of a texture.
+// Both tables share one block, owned by texturecolumnlump.
 //
 void R_GenerateLookup (int texnum)
 {
@@ -306,12 +361,13 @@ void R_GenerateLookup (int texnum)
 	
     texture = textures[texnum];
 
-    // Composited texture not created yet.
-    texturecomposite[texnum] = 0;
-    
+    // Static while the patches are cached, purgable when done.
+    collump = Z_Malloc (texture->width * (sizeof(*collump) + sizeof(*colofs)),
+			PU_STATIC, &texturecolumnlump[texnum]);
+    colofs = (unsigned short *) (collump + texture->width);
+    texturecolumnofs[texnum] = colofs;
+
     texturecompositesize[texnum] = 0;
-    collump = texturecolumnlump[texnum];
-    colofs = texturecolumnofs[texnum];
     
     // Now count the number of columns
     //  that are covered by more than one patch.
@@ -350,7 +406,7 @@ void R_GenerateLookup (int texnum)
 	{
 	    printf ("R_GenerateLookup: column without a patch (%s)\n",
 		    texture->name);
-	    return;
+	    break;
 	}
 	// I_Error ("R_GenerateLookup: column without a patch");
 	
@@ -371,6 +427,7 @@ void R_GenerateLookup (int texnum)
     }
 
     Z_Free(patchcount);
+    Z_ChangeTag (collump, lookuptag);
 }
 
 
@@ -388,6 +445,10 @@ R_GetColumn
     int		ofs;
 	
     col &= texturewidthmask[tex];
+
+    if (!texturecolumnlump[tex])
+	R_GenerateLookup (tex);
+
     lump = texturecolumnlump[tex][col];
     ofs = texturecolumnofs[tex][col];
     
@@ -401,6 +462,161 @@ R_GetColumn
 }
 
 
+//
+// Startup cache layout.
+// Every table is placed at the next 8-byte aligned offset.
+// When writing, the table is copied into the cache buffer
+//  (or only counted, without a buffer); when loading, the
+//  table is pointed into the loaded cache.
+//
+static void *CacheTable (void *table, int size, boolean load)
+{
+    byte*	p;
+
+    // a table past the end of the cache comes back NULL
+    if (size < 0 || size > cachelength - cacheofs)
+	return NULL;
+
+    p = cachebase != NULL ? cachebase + cacheofs : NULL;
+    cacheofs += (size + 7) & ~7;
+
+    if (load)
+	return p;
+
+    if (p != NULL && size > 0)
+	memcpy (p, table, size);
+
+    return table;
+}
+
+#define TEXTURESIZE(t) \
+    (sizeof(texture_t) + sizeof(texpatch_t) * ((t)->patchcount - 1))
+
+//
+// StartupCacheLayout
+// Walks the sections following the header at base, in the same
+//  order for writing and loading. Returns the total length, or
+//  -1 if the sections do not fit in length bytes, or a loaded
+//  count, lump number or texture size is out of range.
+//
+static int StartupCacheLayout (byte *base, int length, boolean load)
+{
+    texture_t*	texture;
+    int*	numframes;
+    int		i;
+    int		j;
+
+    cachebase = base;
+    cacheofs = sizeof(startupcache_t);
+    cachelength = length;
+
+    texturewidthmask = CacheTable (texturewidthmask,
+				   numtextures * sizeof(*texturewidthmask),
+				   load);
+
+    if (texturewidthmask == NULL)
+	return -1;
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (load)
+	{
+	    // the header has to be there before its patch count
+	    if (cachelength - cacheofs < (int) sizeof(texture_t))
+		return -1;
+
+	    texture = (texture_t *) (base + cacheofs);
+
+	    if (texture->patchcount <= 0
+	     || texture->patchcount > cachelength / (int) sizeof(texpatch_t))
+		return -1;
+
+	    // column lookups wrap with the mask, as R_InitTextures made it
+	    if (texture->width <= 0 || texture->height <= 0)
+		return -1;
+
+	    j = 1;
+	    while (j*2 <= texture->width)
+		j<<=1;
+
+	    if (texturewidthmask[i] != j-1)
+		return -1;
+	}
+	else
+	{
+	    texture = textures[i];
+	}
+
+	textures[i] = CacheTable (texture, TEXTURESIZE(texture), load);
+
+	if (textures[i] == NULL)
+	    return -1;
+
+	if (load)
+	{
+	    for (j=0 ; j<texture->patchcount ; j++)
+	    {
+		if (texture->patches[j].patch < 0
+		 || texture->patches[j].patch >= numlumps)
+		    return -1;
+	    }
+	}
+    }
+
+    spritewidth = CacheTable (spritewidth,
+			      numspritelumps * sizeof(*spritewidth), load);
+    spriteoffset = CacheTable (spriteoffset,
+			       numspritelumps * sizeof(*spriteoffset), load);
+    spritetopoffset = CacheTable (spritetopoffset,
+				  numspritelumps * sizeof(*spritetopoffset), load);
+
+    if (spritewidth == NULL || spriteoffset == NULL || spritetopoffset == NULL)
+	return -1;
+
+    // number of frames of each sprite, then the frames
+    numframes = CacheTable (NULL, numsprites * sizeof(*numframes), true);
+
+    if (base != NULL && numframes == NULL)
+	return -1;
+
+    for (i=0 ; i<numsprites ; i++)
+    {
+	if (numframes != NULL)
+	{
+	    if (load)
+	    {
+		if (numframes[i] < 0
+		 || numframes[i] > cachelength / (int) sizeof(spriteframe_t))
+		    return -1;
+
+		sprites[i].numframes = numframes[i];
+	    }
+	    else
+		numframes[i] = sprites[i].numframes;
+	}
+
+	sprites[i].spriteframes =
+	    CacheTable (sprites[i].spriteframes,
+			sprites[i].numframes * sizeof(spriteframe_t), load);
+
+	if (sprites[i].numframes > 0 && sprites[i].spriteframes == NULL)
+	    return -1;
+
+	if (load)
+	{
+	    for (j=0 ; j<sprites[i].numframes*8 ; j++)
+	    {
+		if (sprites[i].spriteframes[j/8].lump[j%8] < 0
+		 || sprites[i].spriteframes[j/8].lump[j%8] >= numspritelumps)
+		    return -1;
+	    }
+	}
+    }
+
+    return cacheofs;
+}
+
+
 static void GenerateTextureHashTable(void)
 {
     texture_t **rover;
@@ -426,7 +642,7 @@ static void GenerateTextureHashTable(void)
         // wins. The new entry must therefore be added at the end
         // of the hash chain, so that earlier entries win.
 
-        key = W_LumpNameHash(textures[i]->name) % numtextures;
+        key = W_LumpKeyHash(textures[i]->key) % numtextures;
 
         rover = &textures_hashtable[key];
 
@@ -443,6 +659,44 @@ static void GenerateTextureHashTable(void)
 }
 
 
+//
+// R_AllocTextureTables
+// Allocates the per texture tables for numtextures.
+//
+static void R_AllocTextureTables (void)
+{
+    textures = Z_Malloc (numtextures * sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = Z_Malloc (numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = Z_Malloc (numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecomposite = Z_Malloc (numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
+    texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
+
+    // Nothing generated or composited yet.
+    memset (texturecolumnlump, 0, numtextures * sizeof(*texturecolumnlump));
+    memset (texturecolumnofs, 0, numtextures * sizeof(*texturecolumnofs));
+    memset (texturecomposite, 0, numtextures * sizeof(*texturecomposite));
+}
+
+
+//
+// R_InitTextureTranslation
+// Creates the translation table for global animation
+//  and the texture name hash table.
+//
+static void R_InitTextureTranslation (void)
+{
+    int		i;
+
+    texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
+    
+    for (i=0 ; i<numtextures ; i++)
+	texturetranslation[i] = i;
+
+    GenerateTextureHashTable();
+}
+
+
 //
 // R_InitTextures
 // Initializes the texture list
@@ -462,7 +716,6 @@ void R_InitTextures (void)
     int*		maptex2;
     int*		maptex1;
     
-    char		name[9];
     char*		names;
     char*		name_p;
     
@@ -484,7 +737,6 @@ void R_InitTextures (void)
 
     
     // Load the patch names from pnames.lmp.
-    name[8] = 0;
     names = W_CacheLumpName ("PNAMES", PU_STATIC);
     nummappatches = LONG ( *((int *)names) );
     name_p = names + 4;
@@ -492,8 +744,7 @@ void R_InitTextures (void)
 
     for (i = 0; i < nummappatches; i++)
     {
-        M_StringCopy(name, name_p + i * 8, sizeof(name));
-        patchlookup[i] = W_CheckNumForName(name);
+        patchlookup[i] = W_CheckNumForKey(W_LumpNameKey(name_p + i * 8));
     }
     W_ReleaseLumpName("PNAMES");
 
@@ -519,13 +770,8 @@ void R_InitTextures (void)
     }
     numtextures = numtextures1 + numtextures2;
 	
-    textures = Z_Malloc (numtextures * sizeof(*textures), PU_STATIC, 0);
-    texturecolumnlump = Z_Malloc (numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
-    texturecolumnofs = Z_Malloc (numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
-    texturecomposite = Z_Malloc (numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
-    texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    R_AllocTextureTables ();
     texturewidthmask = Z_Malloc (numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
-    textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
 
     totalwidth = 0;
     
@@ -578,6 +824,7 @@ void R_InitTextures (void)
 	texture->patchcount = SHORT(mtexture->patchcount);
 	
 	memcpy (texture->name, mtexture->name, sizeof(texture->name));
+	texture->key = W_LumpNameKey(texture->name);
 	mpatch = &mtexture->patches[0];
 	patch = &texture->patches[0];
 
@@ -592,9 +839,6 @@ void R_InitTextures (void)
 			 texture->name);
 	    }
 	}		
-	texturecolumnlump[i] = Z_Malloc (texture->width*sizeof(**texturecolumnlump), PU_STATIC,0);
-	texturecolumnofs[i] = Z_Malloc (texture->width*sizeof(**texturecolumnofs), PU_STATIC,0);
-
 	j = 1;
 	while (j*2 <= texture->width)
 	    j<<=1;
@@ -611,18 +855,23 @@ void R_InitTextures (void)
     if (maptex2)
         W_ReleaseLumpName("TEXTURE2");
     
-    // Precalculate whatever possible.	
+    //!
+    // @category obscure
+    //
+    // Generate the column lookups of all textures at startup and
+    // keep them resident, as Vanilla Doom does, instead of on first
+    // use.
+    //
+
+    if (M_ParmExists ("-eagerlookups"))
+    {
+	lookuptag = PU_STATIC;
 
-    for (i=0 ; i<numtextures ; i++)
-	R_GenerateLookup (i);
-    
-    // Create translation table for global animation.
-    texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
+	for (i=0 ; i<numtextures ; i++)
+	    R_GenerateLookup (i);
+    }
     
-    for (i=0 ; i<numtextures ; i++)
-	texturetranslation[i] = i;
-
-    GenerateTextureHashTable();
+    R_InitTextureTranslation ();
 }
 
 
@@ -652,15 +901,20 @@ void R_InitFlats (void)
 //  so the sprite does not need to be cached completely
 //  just for having the header info ready during rendering.
 //
-void R_InitSpriteLumps (void)
+static void R_FindSpriteLumps (void)
 {
-    int		i;
-    patch_t	*patch;
-	
     firstspritelump = W_GetNumForName ("S_START") + 1;
     lastspritelump = W_GetNumForName ("S_END") - 1;
     
     numspritelumps = lastspritelump - firstspritelump + 1;
+}
+
+void R_InitSpriteLumps (void)
+{
+    int		i;
+    patch_t	*patch;
+	
+    R_FindSpriteLumps ();
     spritewidth = Z_Malloc (numspritelumps*sizeof(*spritewidth), PU_STATIC, 0);
     spriteoffset = Z_Malloc (numspritelumps*sizeof(*spriteoffset), PU_STATIC, 0);
     spritetopoffset = Z_Malloc (numspritelumps*sizeof(*spritetopoffset), PU_STATIC, 0);
@@ -694,6 +948,166 @@ void R_InitColormaps (void)
 
 
 
+//
+// R_StartupCacheFile
+//
+static char *R_StartupCacheFile (void)
+{
+    return M_StringJoin (savegamedir, STARTUPCACHE_FILE, NULL);
+}
+
+
+//
+// R_FillStartupCacheHeader
+//
+static void R_FillStartupCacheHeader (startupcache_t *header, int length)
+{
+    memset (header, 0, sizeof(*header));
+    memcpy (header->magic, "UDRCACHE", sizeof(header->magic));
+    header->version = STARTUPCACHE_VERSION;
+    header->layout = (sizeof(void *) << 24) ^ (sizeof(texture_t) << 12)
+		   ^ (sizeof(texpatch_t) << 8) ^ sizeof(spriteframe_t);
+    W_Checksum (header->digest);
+    header->numtextures = numtextures;
+    header->numspritelumps = numspritelumps;
+    header->numsprites = numsprites;
+    header->length = length;
+}
+
+
+//
+// R_LoadStartupCache
+// Loads the texture and sprite tables from the startup
+//  cache, if it was written for the loaded WADs.
+// The sprite definitions are picked up by R_InitSprites.
+//
+static boolean R_LoadStartupCache (void)
+{
+    startupcache_t	header;
+    startupcache_t	expected;
+    FILE*		handle;
+    char*		filename;
+    byte*		cache;
+    int			count;
+    int			i;
+
+    //!
+    // @category obscure
+    //
+    // Don't use the startup cache: always derive the texture and
+    // sprite tables from the WAD files and don't write the cache.
+    //
+
+    if (M_ParmExists ("-nostartupcache"))
+	return false;
+
+    filename = R_StartupCacheFile ();
+    handle = fopen (filename, "rb");
+    free (filename);
+
+    if (handle == NULL)
+	return false;
+
+    R_FindSpriteLumps ();
+    numsprites = NUMSPRITES;
+
+    if (fread (&header, sizeof(header), 1, handle) != 1)
+    {
+	fclose (handle);
+	return false;
+    }
+
+    // Everything but the counts and the length must match
+    R_FillStartupCacheHeader (&expected, header.length);
+    expected.numtextures = header.numtextures;
+
+    if (memcmp (&header, &expected, sizeof(header))
+     || header.numtextures <= 0
+     || header.numtextures > header.length / (int) sizeof(texture_t)
+     || header.length <= (int) sizeof(header)
+     || header.length > M_FileLength (handle))
+    {
+	printf ("R_LoadStartupCache: cache is out of date\n");
+	fclose (handle);
+	return false;
+    }
+
+    cache = Z_Malloc (header.length, PU_STATIC, NULL);
+    memcpy (cache, &header, sizeof(header));
+    count = fread (cache + sizeof(header), 1,
+		   header.length - sizeof(header), handle);
+    fclose (handle);
+
+    if (count != header.length - (int) sizeof(header))
+    {
+	Z_Free (cache);
+	return false;
+    }
+
+    numtextures = header.numtextures;
+    R_AllocTextureTables ();
+    sprites = Z_Malloc (numsprites * sizeof(*sprites), PU_STATIC, NULL);
+
+    if (StartupCacheLayout (cache, header.length, true) != header.length)
+    {
+	printf ("R_LoadStartupCache: cache file is corrupt\n");
+
+	// R_InitTextures and R_InitSpriteDefs allocate their own
+	Z_Free (textures);
+	Z_Free (texturecolumnlump);
+	Z_Free (texturecolumnofs);
+	Z_Free (texturecomposite);
+	Z_Free (texturecompositesize);
+	Z_Free (textureheight);
+	Z_Free (sprites);
+	sprites = NULL;
+	Z_Free (cache);
+	return false;
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+	textureheight[i] = textures[i]->height<<FRACBITS;
+
+    R_InitTextureTranslation ();
+
+    return true;
+}
+
+
+//
+// R_SaveStartupCache
+// Writes the tables derived at this boot to the startup
+//  cache. Must be called after R_InitSprites.
+//
+void R_SaveStartupCache (void)
+{
+    startupcache_t	header;
+    char*		filename;
+    byte*		cache;
+    int			length;
+
+    if (startupcacheloaded || M_ParmExists ("-nostartupcache"))
+	return;
+
+    cachebase = NULL;
+    length = StartupCacheLayout (NULL, INT_MAX, false);
+    cache = Z_Malloc (length, PU_STATIC, NULL);
+    memset (cache, 0, length);
+
+    R_FillStartupCacheHeader (&header, length);
+    memcpy (cache, &header, sizeof(header));
+    StartupCacheLayout (cache, length, false);
+
+    filename = R_StartupCacheFile ();
+
+    if (!M_WriteFile (filename, cache, length))
+	printf ("R_SaveStartupCache: couldn't write %s\n", filename);
+
+    free (filename);
+    Z_Free (cache);
+}
+
+
 //
 // R_InitData
 // Locates all the lumps
@@ -702,11 +1116,15 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
-    R_InitTextures ();
+    startupcacheloaded = R_LoadStartupCache ();
+
+    if (!startupcacheloaded)
+	R_InitTextures ();
     printf (".");
     R_InitFlats ();
     printf (".");
-    R_InitSpriteLumps ();
+    if (!startupcacheloaded)
+	R_InitSpriteLumps ();
     printf (".");
     R_InitColormaps ();
 }
@@ -744,19 +1162,21 @@ int R_FlatNumForName (char* name)
 int	R_CheckTextureNumForName (char *name)
 {
     texture_t *texture;
+    uint64_t namekey;
     int key;
 
     // "NoTexture" marker.
     if (name[0] == '-')		
 	return 0;
 		
-    key = W_LumpNameHash(name) % numtextures;
+    namekey = W_LumpNameKey(name);
+    key = W_LumpKeyHash(namekey) % numtextures;
 
     texture=textures_hashtable[key]; 
     
     while (texture != NULL)
     {
-	if (!strncasecmp (texture->name, name, 8) )
+	if (texture->key == namekey)
 	    return texture->index;
 
         texture = texture->next;
@@ -792,28 +1212,67 @@ int	R_TextureNumForName (char* name)
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
+// The working set (flats, texture patches and sprite frames)
+//  is collected first and read in file order, see
+//  W_PreloadLumps. Multi-patch textures are composited right
+//  away, so there are no hitches when they first come into view.
+// If the working set fits comfortably into the zone, the lumps
+//  the renderer fetches itself (flats, sprites and patches that
+//  single-patch columns are drawn from) are tagged PU_LEVEL, so
+//  they can not be purged before the renderer first touches each
+//  one and sets it to PU_CACHE. Patches only used for composites
+//  stay purgable.
+// Demo playback is preloaded too, but -timedemo and runs with no
+//  drawing are not.
 //
 int		flatmemory;
 int		texturememory;
 int		spritememory;
 
+// lumppresent values
+#define PRECACHE_PATCH	1	// a texture patch
+#define PRECACHE_DIRECT	2	// fetched by the renderer itself
+
+static void R_PrecacheLump (byte *lumppresent, int lump, int *memory)
+{
+    if (!lumppresent[lump])
+    {
+	lumppresent[lump] = PRECACHE_PATCH;
+	*memory += lumpinfo[lump].size;
+    }
+}
+
 void R_PrecacheLevel (void)
 {
     char*		flatpresent;
     char*		texturepresent;
     char*		spritepresent;
+    byte*		lumppresent;
+    int*		lumplist;
 
     int			i;
     int			j;
     int			k;
     int			lump;
+    int			count;
+    int			reads;
+    int			budget;
+    int			tag;
+    int			starttime;
     
     texture_t*		texture;
-    thinker_t*		th;
+    mobj_t*		mo;
     spriteframe_t*	sf;
+    short*		collump;
 
-    if (demoplayback)
+    // Timed and headless playback measure the game, not the disk.
+    if (timingdemo || nodrawers)
 	return;
+
+    starttime = I_GetTimeMS();
+
+    lumppresent = Z_Malloc(numlumps, PU_STATIC, NULL);
+    memset (lumppresent,0,numlumps);
     
     // Precache flats.
     flatpresent = Z_Malloc(numflats, PU_STATIC, NULL);
@@ -831,9 +1290,8 @@ void R_PrecacheLevel (void)
     {
 	if (flatpresent[i])
 	{
-	    lump = firstflat + i;
-	    flatmemory += lumpinfo[lump].size;
-	    W_CacheLumpNum(lump, PU_CACHE);
+	    R_PrecacheLump (lumppresent, firstflat + i, &flatmemory);
+	    lumppresent[firstflat + i] = PRECACHE_DIRECT;
 	}
     }
 
@@ -869,22 +1327,16 @@ void R_PrecacheLevel (void)
 	for (j=0 ; j<texture->patchcount ; j++)
 	{
 	    lump = texture->patches[j].patch;
-	    texturememory += lumpinfo[lump].size;
-	    W_CacheLumpNum(lump , PU_CACHE);
+	    R_PrecacheLump (lumppresent, lump, &texturememory);
 	}
     }
 
-    Z_Free(texturepresent);
-    
     // Precache sprites.
     spritepresent = Z_Malloc(numsprites, PU_STATIC, NULL);
     memset (spritepresent,0, numsprites);
 	
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    {
-	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-	    spritepresent[((mobj_t *)th)->sprite] = 1;
-    }
+    for (mo = mobjlist ; mo ; mo = mo->lnext)
+	spritepresent[mo->sprite] = 1;
 	
     spritememory = 0;
     for (i=0 ; i<numsprites ; i++)
@@ -898,15 +1350,81 @@ void R_PrecacheLevel (void)
 	    for (k=0 ; k<8 ; k++)
 	    {
 		lump = firstspritelump + sf->lump[k];
-		spritememory += lumpinfo[lump].size;
-		W_CacheLumpNum(lump , PU_CACHE);
+		R_PrecacheLump (lumppresent, lump, &spritememory);
+		lumppresent[lump] = PRECACHE_DIRECT;
 	    }
 	}
     }
 
     Z_Free(spritepresent);
-}
 
+    // Keep the working set until first use only if it leaves
+    //  at least as much room for the level to run.
+    budget = Z_FreeMemory ();
+
+    if (flatmemory + texturememory + spritememory <= budget / 2)
+	tag = PU_LEVEL;
+    else
+	tag = PU_CACHE;
+
+    // Read it in file order.
+    count = 0;
+    lumplist = Z_Malloc(numlumps * sizeof(*lumplist), PU_STATIC, NULL);
+
+    for (i=0 ; i<numlumps ; i++)
+    {
+	if (lumppresent[i])
+	    lumplist[count++] = i;
+    }
+
+    reads = W_PreloadLumps (lumplist, count, tag);
+
+    // Composite the multi-patch textures from the loaded patches.
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (!texturepresent[i])
+	    continue;
+
+	if (!texturecolumnlump[i])
+	    R_GenerateLookup (i);
 
+	if (texturecompositesize[i] && !texturecomposite[i])
+	    R_GenerateComposite (i);
 
+	// nothing has been allocated since, so the lookup is still here
+	collump = texturecolumnlump[i];
 
+	for (j=0 ; j<textures[i]->width ; j++)
+	{
+	    if (collump[j] > 0)
+		lumppresent[collump[j]] = PRECACHE_DIRECT;
+	}
+    }
+
+    Z_Free(texturepresent);
+
+    // Compositing has released the patches to PU_CACHE. Pin
+    //  again what the renderer will ask for, unless compositing
+    //  has purged it.
+    if (tag != PU_CACHE)
+    {
+	for (i=0 ; i<count ; i++)
+	{
+	    lump = lumplist[i];
+
+	    if (lumppresent[lump] == PRECACHE_DIRECT
+	     && lumpinfo[lump].cache != NULL)
+		W_CacheLumpNum (lump, tag);
+	}
+    }
+
+    Z_Free(lumppresent);
+    Z_Free(lumplist);
+
+    printf ("R_PrecacheLevel: %i lumps, %i KB (flats %i, textures %i, "
+	    "sprites %i KB) of %i KB zone budget%s, %i reads in %i ms\n",
+	    count, (flatmemory + texturememory + spritememory) / 1024,
+	    flatmemory / 1024, texturememory / 1024, spritememory / 1024,
+	    budget / 1024, tag == PU_LEVEL ? "" : " (purgable)",
+	    reads, I_GetTimeMS() - starttime);
+}
@@ -34,8 +34,12 @@ R_GetColumn
 
 // I/O, setting up the stuff.
 void R_InitData (void);
+void R_SaveStartupCache (void);
 void R_PrecacheLevel (void);
 
+// true if R_InitData loaded the startup cache
+extern boolean startupcacheloaded;
+
 
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
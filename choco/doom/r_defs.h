@@ -127,6 +127,14 @@ typedef	struct
 
     int			linecount;
     struct line_s**	lines;	// [linecount] size
+
+    // tag hash chain: firsttag heads the bucket for tag % numsectors,
+    // nexttag links sectors of that bucket in ascending order
+    int		firsttag;
+    int		nexttag;
+
+    // first teleport destination in this sector, in thinker order
+    mobj_t*	teleportdest;
     
 } sector_t;
 
@@ -211,6 +219,23 @@ typedef struct line_s
 } line_t;
 
 
+//
+// Packed copy of the fields the collision tests read for
+// every blockmap line, so the hot loops touch one small
+// contiguous record instead of line_t plus its vertex.
+// Indexed like lines[]; the geometry never changes in a level.
+//
+typedef struct
+{
+    fixed_t	bbox[4];
+    fixed_t	x;		// v1
+    fixed_t	y;
+    fixed_t	dx;
+    fixed_t	dy;
+    slopetype_t	slopetype;
+} linecoll_t;
+
+
 
 
 //
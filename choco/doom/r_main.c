@@ -45,6 +45,7 @@
 
 
 int			viewangleoffset;
+int			latchedturn;
 
 // increment every time a check is made
 int			validcount = 1;		
@@ -827,7 +828,7 @@ void R_SetupFrame (player_t* player)
     viewplayer = player;
     viewx = player->mo->x;
     viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
+    viewangle = player->mo->angle + viewangleoffset + latchedturn;
     extralight = player->extralight;
 
     viewz = player->viewz;
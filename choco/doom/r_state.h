@@ -86,6 +86,7 @@ extern node_t*		nodes;
 
 extern int		numlines;
 extern line_t*		lines;
+extern linecoll_t*	linecolls;
 
 extern int		numsides;
 extern side_t*		sides;
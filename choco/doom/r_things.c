@@ -153,6 +153,30 @@ R_InstallSpriteLump
 
 
 
+//
+// R_SpritePrefixSlot
+// Local function for R_InitSpriteDefs.
+// Returns the slot holding prefix, or the empty slot
+//  where it would go. A 0 prefix marks an empty slot.
+//
+static int
+R_SpritePrefixSlot
+( uint32_t*	slotprefix,
+  int		numslots,
+  uint32_t	prefix )
+{
+    int		slot;
+
+    slot = W_LumpKeyHash(prefix) & (numslots - 1);
+
+    while (slotprefix[slot] != 0 && slotprefix[slot] != prefix)
+	slot = (slot + 1) & (numslots - 1);
+
+    return slot;
+}
+
+
+
 //
 // R_InitSpriteDefs
 // Pass a null terminated list of sprite names
@@ -168,6 +192,10 @@ R_InstallSpriteLump
 //  letter/number appended.
 // The rotation character can be 0 to signify no rotations.
 //
+// The sprite lumps are indexed by their 4 character prefix
+//  in a single pass, so every sprite only visits its own
+//  lumps (in directory order, as a full scan would).
+//
 void R_InitSpriteDefs (char** namelist) 
 { 
     char**	check;
@@ -175,9 +203,14 @@ void R_InitSpriteDefs (char** namelist)
     int		l;
     int		frame;
     int		rotation;
-    int		start;
-    int		end;
     int		patched;
+    int		numslots;
+    int		slot;
+    uint32_t	prefix;
+    uint32_t*	slotprefix;
+    int*	slotfirst;
+    int*	slotlast;
+    int*	nextlump;
 		
     // count the number of sprite names
     check = namelist;
@@ -190,42 +223,79 @@ void R_InitSpriteDefs (char** namelist)
 	return;
 		
     sprites = Z_Malloc(numsprites *sizeof(*sprites), PU_STATIC, NULL);
-	
-    start = firstspritelump-1;
-    end = lastspritelump+1;
-	
-    // scan all the lump names for each of the names,
+
+    // Open addressed table of the sprite name prefixes, at most
+    //  half full. The low 32 bits of a lump key are its first
+    //  4 characters, upper-cased.
+    numslots = 1;
+    while (numslots < numsprites * 2)
+	numslots <<= 1;
+
+    slotprefix = Z_Malloc(numslots * sizeof(*slotprefix), PU_STATIC, NULL);
+    slotfirst = Z_Malloc(numslots * sizeof(*slotfirst), PU_STATIC, NULL);
+    slotlast = Z_Malloc(numslots * sizeof(*slotlast), PU_STATIC, NULL);
+    memset (slotprefix, 0, numslots * sizeof(*slotprefix));
+    memset (slotfirst, -1, numslots * sizeof(*slotfirst));
+
+    for (i=0 ; i<numsprites ; i++)
+    {
+	prefix = (uint32_t) W_LumpNameKey(namelist[i]);
+	slot = R_SpritePrefixSlot(slotprefix, numslots, prefix);
+	slotprefix[slot] = prefix;
+    }
+
+    // chain the sprite lumps to the slot of their prefix,
+    //  keeping the directory order
+    nextlump = Z_Malloc(numspritelumps * sizeof(*nextlump), PU_STATIC, NULL);
+
+    for (l=firstspritelump ; l<=lastspritelump ; l++)
+    {
+	nextlump[l - firstspritelump] = -1;
+	prefix = (uint32_t) lumpinfo[l].key;
+	slot = R_SpritePrefixSlot(slotprefix, numslots, prefix);
+
+	if (prefix == 0 || slotprefix[slot] != prefix)
+	    continue;
+
+	if (slotfirst[slot] == -1)
+	    slotfirst[slot] = l;
+	else
+	    nextlump[slotlast[slot] - firstspritelump] = l;
+
+	slotlast[slot] = l;
+    }
+
+    // install the lumps found for each of the names,
     //  noting the highest frame letter.
-    // Just compare 4 characters as ints
     for (i=0 ; i<numsprites ; i++)
     {
 	spritename = namelist[i];
 	memset (sprtemp,-1, sizeof(sprtemp));
 		
 	maxframe = -1;
+
+	slot = R_SpritePrefixSlot(slotprefix, numslots,
+				  (uint32_t) W_LumpNameKey(spritename));
 	
-	// scan the lumps,
+	// walk the lumps of this sprite,
 	//  filling in the frames for whatever is found
-	for (l=start+1 ; l<end ; l++)
+	for (l=slotfirst[slot] ; l != -1 ; l=nextlump[l - firstspritelump])
 	{
-	    if (!strncasecmp(lumpinfo[l].name, spritename, 4))
+	    frame = lumpinfo[l].name[4] - 'A';
+	    rotation = lumpinfo[l].name[5] - '0';
+
+	    if (modifiedgame)
+		patched = W_CheckNumForKey (lumpinfo[l].key);
+	    else
+		patched = l;
+
+	    R_InstallSpriteLump (patched, frame, rotation, false);
+
+	    if (lumpinfo[l].name[6])
 	    {
-		frame = lumpinfo[l].name[4] - 'A';
-		rotation = lumpinfo[l].name[5] - '0';
-
-		if (modifiedgame)
-		    patched = W_GetNumForName (lumpinfo[l].name);
-		else
-		    patched = l;
-
-		R_InstallSpriteLump (patched, frame, rotation, false);
-
-		if (lumpinfo[l].name[6])
-		{
-		    frame = lumpinfo[l].name[6] - 'A';
-		    rotation = lumpinfo[l].name[7] - '0';
-		    R_InstallSpriteLump (l, frame, rotation, true);
-		}
+		frame = lumpinfo[l].name[6] - 'A';
+		rotation = lumpinfo[l].name[7] - '0';
+		R_InstallSpriteLump (l, frame, rotation, true);
 	    }
 	}
 	
@@ -270,6 +340,10 @@ void R_InitSpriteDefs (char** namelist)
 	memcpy (sprites[i].spriteframes, sprtemp, maxframe*sizeof(spriteframe_t));
     }
 
+    Z_Free(nextlump);
+    Z_Free(slotlast);
+    Z_Free(slotfirst);
+    Z_Free(slotprefix);
 }
 
 
@@ -296,8 +370,10 @@ void R_InitSprites (char** namelist)
     {
 	negonearray[i] = -1;
     }
-	
-    R_InitSpriteDefs (namelist);
+
+    // already loaded from the startup cache?
+    if (sprites == NULL)
+	R_InitSpriteDefs (namelist);
 }
 
 
@@ -0,0 +1,1294 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Software sound effect mixer.
+//
+//	Sound effects are converted from DMX lumps (unsigned 8-bit, most
+//	at 11025 Hz) to signed 16-bit at snd_samplerate the first time
+//	they are played, or at startup while they fit. The converted
+//	sounds are purgeable zone blocks, and the least recently used
+//	ones are freed to keep them within snd_cachesize.
+//
+//	The sounds playing on each channel are mixed to 16-bit stereo
+//	in a ring buffer, a block of frames at a time, by
+//	I_MixSoundTick. The board calls it from a timer interrupt, so
+//	the mix does not depend on the game loop: a long frame such as
+//	a level load does not stall it. Each tick mixes until the ring
+//	is snd_maxslicetime_ms ahead of the output; if the output has
+//	caught up with the mix, the frames it missed are silence and
+//	count as an underrun.
+//
+//	The game thread does not touch the channels. Starting, stopping
+//	and panning sounds post commands to a lock-free ring that the
+//	next tick runs, and the mixer hands back the sounds it has
+//	stopped playing on another, so that the game thread, which owns
+//	the zone, can release them.
+//
+//	A music module can hook into the mixer to have its output added
+//	to each block, with saturation. It runs in the mixer too, and
+//	changes its state with commands of its own.
+//
+//	The board has no audio output driver, so the output is only a
+//	clock: I_GetTimeUS at snd_samplerate, as a DMA would consume the
+//	ring. The game thread copies the mixed frames to a WAV file
+//	(-wavout) as it gets to them.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+
+#include "i_sound.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+// Channels that can be mixed at once.
+#define MIXCHANNELS	16
+
+// Frames mixed in one pass of the kernel.
+#define MIXBLOCK	64
+
+// Stereo frames in the ring buffer; a power of two.
+#define RINGFRAMES	4096
+
+// Commands the game thread can post before the mixer runs them,
+// and sounds the mixer can hand back; powers of two.
+#define CMDRINGSIZE	64
+#define DONERINGSIZE	128
+
+// Channel gains are Q12, so that even MIXCHANNELS full scale
+// samples at full gain add up without overflowing 32 bits.
+#define GAINBITS	12
+
+// A sound effect converted to the output format. The samples are
+// a zone block, PU_CACHE while no channel plays them, so the zone
+// can purge them; it then sets samples to NULL.
+
+typedef struct cachedsound_s cachedsound_t;
+
+struct cachedsound_s
+{
+    sfxinfo_t *sfxinfo;
+    int16_t *samples;
+    unsigned int length;	// in frames
+    int use_count;		// channels playing it
+    cachedsound_t *prev, *next;	// most recently used first
+};
+
+// Channels belong to the mixer.
+
+typedef struct
+{
+    cachedsound_t *sound;	// NULL if not playing
+    unsigned int serial;	// of the command that started it
+    unsigned int pos;		// in frames
+    int gain_left;		// Q12
+    int gain_right;
+} mixchannel_t;
+
+typedef enum
+{
+    MIXCMD_START,
+    MIXCMD_STOP,
+    MIXCMD_PARAMS,
+    MIXCMD_MUSIC,
+} mixcmdtype_t;
+
+typedef struct
+{
+    mixcmdtype_t type;
+    int channel;
+    cachedsound_t *sound;		// MIXCMD_START
+    unsigned int serial;		// MIXCMD_START, MIXCMD_STOP
+    int gain_left, gain_right;		// MIXCMD_START, MIXCMD_PARAMS
+    mixmusic_command_t func;		// MIXCMD_MUSIC
+    void *data;
+    int arg;
+} mixcmd_t;
+
+// A sound the mixer has stopped playing on a channel.
+
+typedef struct
+{
+    cachedsound_t *sound;
+    int channel;
+    unsigned int serial;
+} mixdone_t;
+
+static boolean sound_initialized = false;
+static boolean use_sfx_prefix;
+
+static mixchannel_t channels[MIXCHANNELS];
+
+// What the game thread has asked the channels to do.
+
+static unsigned int channel_serial[MIXCHANNELS];
+static boolean channel_playing[MIXCHANNELS];
+
+// The head of each ring is only written by its producer, and the
+// tail by its consumer; they count entries ever posted and taken.
+
+static mixcmd_t cmdring[CMDRINGSIZE];
+static unsigned int cmdhead, cmdtail;
+
+static mixdone_t donering[DONERINGSIZE];
+static unsigned int donehead, donetail;
+
+static cachedsound_t *cache_head;
+static cachedsound_t *cache_tail;
+
+// Resampled channels, two to a word as SMLAD wants them, and
+// their gains paired the same way.
+
+static uint32_t mixbuf[MIXCHANNELS / 2][MIXBLOCK];
+static uint32_t mixgain_left[MIXCHANNELS / 2];
+static uint32_t mixgain_right[MIXCHANNELS / 2];
+
+// Music, added to the mixed block.
+
+static mixmusic_callback_t mixmusic;
+static uint32_t musicbuf[MIXBLOCK];
+
+// Stereo frames, as words so QADD16 can add them a frame at a time.
+
+static uint32_t ringbuf[RINGFRAMES];
+static unsigned int ringhead;		// frames mixed
+static unsigned int ringtail;		// frames sent to the sink
+
+static uint64_t mixstart;		// I_GetTimeUS the output started at
+static unsigned int lookahead;		// frames to mix ahead of the output
+
+// Mixing cost since the last I_MixSoundStats; written by the mixer.
+
+static uint32_t mixtime;
+static uint32_t mixticks;
+static uint32_t mixunderruns;
+
+// Sound cache statistics since the last I_MixSoundCacheStats.
+
+static uint64_t converttime;
+static int cachehits;
+static int cachemisses;
+
+// WAV sink.
+
+static FILE *wavfile;
+static uint32_t wavframes;
+
+//
+// Mixing kernel
+//
+
+#if defined(__ARM_FEATURE_DSP)
+
+// acc + lo(x) * lo(y) + hi(x) * hi(y)
+
+static inline int32_t MixSMLAD(uint32_t x, uint32_t y, int32_t acc)
+{
+    __asm__ ("smlad %0, %1, %2, %3"
+             : "=r" (acc) : "r" (x), "r" (y), "r" (acc));
+    return acc;
+}
+
+// Scale a Q12 sum back and saturate it to 16 bits.
+
+static inline int32_t MixSSAT(int32_t acc)
+{
+    int32_t result;
+
+    __asm__ ("ssat %0, #16, %1, asr #12" : "=r" (result) : "r" (acc));
+    return result;
+}
+
+// Saturating add of the two halves of x and y.
+
+static inline uint32_t MixQADD16(uint32_t x, uint32_t y)
+{
+    uint32_t result;
+
+    __asm__ ("qadd16 %0, %1, %2" : "=r" (result) : "r" (x), "r" (y));
+    return result;
+}
+
+#else
+
+static inline int32_t MixSMLAD(uint32_t x, uint32_t y, int32_t acc)
+{
+    return acc + (int16_t) x * (int16_t) y
+               + (int16_t) (x >> 16) * (int16_t) (y >> 16);
+}
+
+static inline int32_t MixSSAT(int32_t acc)
+{
+    acc >>= GAINBITS;
+
+    if (acc > 32767)
+        return 32767;
+    else if (acc < -32768)
+        return -32768;
+    else
+        return acc;
+}
+
+static inline int16_t Saturate16(int32_t x)
+{
+    if (x > 32767)
+        return 32767;
+    else if (x < -32768)
+        return -32768;
+    else
+        return x;
+}
+
+static inline uint32_t MixQADD16(uint32_t x, uint32_t y)
+{
+    return (uint16_t) Saturate16((int16_t) x + (int16_t) y)
+         | ((uint32_t) (uint16_t) Saturate16((int16_t) (x >> 16)
+                                             + (int16_t) (y >> 16)) << 16);
+}
+
+#endif
+
+static void MixKernel(int16_t *out, int pairs, int frames)
+{
+    int i, p;
+
+    for (i=0; i<frames; ++i)
+    {
+        int32_t left = 0;
+        int32_t right = 0;
+
+        for (p=0; p<pairs; ++p)
+        {
+            left = MixSMLAD(mixbuf[p][i], mixgain_left[p], left);
+            right = MixSMLAD(mixbuf[p][i], mixgain_right[p], right);
+        }
+
+        out[0] = MixSSAT(left);
+        out[1] = MixSSAT(right);
+        out += 2;
+    }
+}
+
+//
+// Sound cache
+//
+
+static void LinkSound(cachedsound_t *sound)
+{
+    sound->prev = NULL;
+    sound->next = cache_head;
+
+    if (cache_head != NULL)
+    {
+        cache_head->prev = sound;
+    }
+    else
+    {
+        cache_tail = sound;
+    }
+
+    cache_head = sound;
+}
+
+static void UnlinkSound(cachedsound_t *sound)
+{
+    if (sound->prev != NULL)
+    {
+        sound->prev->next = sound->next;
+    }
+    else
+    {
+        cache_head = sound->next;
+    }
+
+    if (sound->next != NULL)
+    {
+        sound->next->prev = sound->prev;
+    }
+    else
+    {
+        cache_tail = sound->prev;
+    }
+}
+
+// Bytes of converted samples the zone still holds.
+
+static int CacheSize(void)
+{
+    cachedsound_t *sound;
+    int total = 0;
+
+    for (sound = cache_head; sound != NULL; sound = sound->next)
+    {
+        if (sound->samples != NULL)
+        {
+            total += sound->length * sizeof(int16_t);
+        }
+    }
+
+    return total;
+}
+
+// Check that len more bytes fit in snd_cachesize (zero for no limit),
+// first freeing the least recently used sounds no channel is playing
+// if evict is set.
+
+static boolean ReserveCacheSpace(int len, boolean evict)
+{
+    cachedsound_t *sound;
+    int total;
+
+    if (snd_cachesize == 0)
+    {
+        return true;
+    }
+
+    total = CacheSize();
+
+    if (evict)
+    {
+        for (sound = cache_tail;
+             sound != NULL && total + len > snd_cachesize;
+             sound = sound->prev)
+        {
+            if (sound->samples != NULL && sound->use_count == 0)
+            {
+                total -= sound->length * sizeof(int16_t);
+                Z_Free(sound->samples);
+            }
+        }
+    }
+
+    return total + len <= snd_cachesize;
+}
+
+// Convert a DMX lump to snd_samplerate, with linear interpolation.
+// The DMX padding after the samples makes it safe to read one
+// sample past the end.
+
+static boolean ConvertSound(cachedsound_t *sound, int lumpnum, boolean evict)
+{
+    const byte *data;
+    unsigned int lumplen;
+    unsigned int length;
+    unsigned int frames;
+    uint32_t pos, step;
+    uint64_t start;
+    int samplerate;
+    unsigned int i;
+
+    start = I_GetTimeUS();
+
+    // DMX header: format 3, sample rate, length, then 16 bytes
+    // of padding before and after the samples.
+
+    data = W_CacheLumpNum(lumpnum, PU_STATIC);
+    lumplen = W_LumpLength(lumpnum);
+
+    samplerate = (data[3] << 8) | data[2];
+    length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+
+    if (lumplen < 8 || data[0] != 0x03 || data[1] != 0x00
+     || length > lumplen - 8 || length <= 48 || samplerate == 0)
+    {
+        W_ReleaseLumpNum(lumpnum);
+        return false;
+    }
+
+    data += 8 + 16;
+    length -= 32;
+
+    frames = (uint64_t) length * snd_samplerate / samplerate;
+
+    if (!ReserveCacheSpace(frames * sizeof(int16_t), evict))
+    {
+        W_ReleaseLumpNum(lumpnum);
+        return false;
+    }
+
+    Z_Malloc(frames * sizeof(int16_t), PU_STATIC, &sound->samples);
+    sound->length = frames;
+
+    step = ((uint64_t) samplerate << 16) / snd_samplerate;
+
+    for (i=0, pos=0; i<frames; ++i, pos += step)
+    {
+        const byte *s = data + (pos >> 16);
+        int frac = (pos >> 4) & 0xfff;
+
+        sound->samples[i] = (s[0] - 128) * 256 + (((s[1] - s[0]) * frac) >> 4);
+    }
+
+    W_ReleaseLumpNum(lumpnum);
+
+    converttime += I_GetTimeUS() - start;
+
+    return true;
+}
+
+// Get the converted sound for sfxinfo, converting it if it is not
+// in the cache. The samples are left PU_STATIC.
+
+static cachedsound_t *CacheSound(sfxinfo_t *sfxinfo, int lumpnum,
+                                 boolean evict)
+{
+    cachedsound_t *sound = sfxinfo->driver_data;
+
+    if (sound == NULL)
+    {
+        sound = Z_Malloc(sizeof(cachedsound_t), PU_STATIC, NULL);
+        sound->sfxinfo = sfxinfo;
+        sound->samples = NULL;
+        sound->use_count = 0;
+        LinkSound(sound);
+        sfxinfo->driver_data = sound;
+    }
+
+    if (sound->samples != NULL)
+    {
+        Z_ChangeTag(sound->samples, PU_STATIC);
+        ++cachehits;
+    }
+    else
+    {
+        ++cachemisses;
+
+        if (!ConvertSound(sound, lumpnum, evict))
+        {
+            return NULL;
+        }
+    }
+
+    UnlinkSound(sound);
+    LinkSound(sound);
+
+    return sound;
+}
+
+static void ReleaseSound(cachedsound_t *sound)
+{
+    if (sound->use_count == 0)
+    {
+        Z_ChangeTag(sound->samples, PU_CACHE);
+    }
+}
+
+//
+// Channels
+//
+
+// Stop a channel and hand its sound back to the game thread.
+// RunCommands leaves room in donering for every channel.
+
+static void DropChannel(int channel)
+{
+    mixchannel_t *c = &channels[channel];
+    mixdone_t *done;
+
+    if (c->sound == NULL)
+    {
+        return;
+    }
+
+    done = &donering[donehead & (DONERINGSIZE - 1)];
+    done->sound = c->sound;
+    done->channel = channel;
+    done->serial = c->serial;
+    __atomic_store_n(&donehead, donehead + 1, __ATOMIC_RELEASE);
+
+    c->sound = NULL;
+}
+
+// Copy frames of a channel into every other int16_t of dest.
+
+static void GatherChannel(int channel, int16_t *dest, int frames)
+{
+    mixchannel_t *c = &channels[channel];
+    const int16_t *src = c->sound->samples + c->pos;
+    int n = c->sound->length - c->pos;
+    int i;
+
+    if (n > frames)
+    {
+        n = frames;
+    }
+
+    for (i=0; i<n; ++i)
+    {
+        dest[i * 2] = src[i];
+    }
+
+    c->pos += n;
+
+    if (n < frames)
+    {
+        for (; i<frames; ++i)
+        {
+            dest[i * 2] = 0;
+        }
+
+        DropChannel(channel);
+    }
+}
+
+static void AddMusic(uint32_t *out, int frames)
+{
+    mixmusic_callback_t callback;
+    int i;
+
+    callback = __atomic_load_n(&mixmusic, __ATOMIC_ACQUIRE);
+
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    callback((int16_t *) musicbuf, frames);
+
+    for (i=0; i<frames; ++i)
+    {
+        out[i] = MixQADD16(out[i], musicbuf[i]);
+    }
+}
+
+static void MixBlock(uint32_t *out, int frames)
+{
+    int16_t *slots = (int16_t *) mixbuf;
+    int16_t gains_left[MIXCHANNELS];
+    int16_t gains_right[MIXCHANNELS];
+    int active;
+    int i;
+
+    // Gather the playing channels into consecutive slots.
+
+    active = 0;
+
+    for (i=0; i<MIXCHANNELS; ++i)
+    {
+        if (channels[i].sound != NULL)
+        {
+            GatherChannel(i, slots + (active / 2) * MIXBLOCK * 2
+                                   + (active & 1), frames);
+            gains_left[active] = channels[i].gain_left;
+            gains_right[active] = channels[i].gain_right;
+            ++active;
+        }
+    }
+
+    if (active == 0)
+    {
+        memset(out, 0, frames * sizeof(uint32_t));
+    }
+    else
+    {
+        // An odd slot out mixes at no gain.
+
+        if (active & 1)
+        {
+            gains_left[active] = gains_right[active] = 0;
+        }
+
+        for (i=0; i<(active + 1) / 2; ++i)
+        {
+            mixgain_left[i] = (uint16_t) gains_left[i * 2]
+                            | ((uint32_t) (uint16_t) gains_left[i * 2 + 1] << 16);
+            mixgain_right[i] = (uint16_t) gains_right[i * 2]
+                             | ((uint32_t) (uint16_t) gains_right[i * 2 + 1] << 16);
+        }
+
+        MixKernel((int16_t *) out, (active + 1) / 2, frames);
+    }
+
+    AddMusic(out, frames);
+}
+
+//
+// WAV sink
+//
+
+static void WriteLE(byte *p, uint32_t value, int bytes)
+{
+    int i;
+
+    for (i=0; i<bytes; ++i)
+    {
+        p[i] = (value >> (i * 8)) & 0xff;
+    }
+}
+
+static void WriteWAVHeader(void)
+{
+    byte header[44];
+    uint32_t datasize = wavframes * 4;
+
+    memcpy(header, "RIFF", 4);
+    WriteLE(header + 4, 36 + datasize, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteLE(header + 16, 16, 4);                  // fmt chunk size
+    WriteLE(header + 20, 1, 2);                   // PCM
+    WriteLE(header + 22, 2, 2);                   // stereo
+    WriteLE(header + 24, snd_samplerate, 4);
+    WriteLE(header + 28, snd_samplerate * 4, 4);  // bytes per second
+    WriteLE(header + 32, 4, 2);                   // bytes per frame
+    WriteLE(header + 34, 16, 2);                  // bits per sample
+    memcpy(header + 36, "data", 4);
+    WriteLE(header + 40, datasize, 4);
+
+    fseek(wavfile, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), wavfile);
+    fseek(wavfile, 0, SEEK_END);
+}
+
+// Send frames to the sink; NULL frames are silence.
+
+static void SinkFrames(const int16_t *frames, int count)
+{
+    static const int16_t silence[MIXBLOCK * 2];
+    byte buf[MIXBLOCK * 4];
+    int n, i;
+
+    if (wavfile == NULL)
+    {
+        return;
+    }
+
+    wavframes += count;
+
+    while (count > 0)
+    {
+        n = count < MIXBLOCK ? count : MIXBLOCK;
+
+        for (i=0; i<n * 2; ++i)
+        {
+            WriteLE(buf + i * 2, (uint16_t) (frames ? frames[i] : silence[i]), 2);
+        }
+
+        fwrite(buf, 4, n, wavfile);
+
+        if (frames != NULL)
+        {
+            frames += n * 2;
+        }
+        count -= n;
+    }
+}
+
+// Copy the frames mixed since the last call to the sink. The mixer
+// may be overwriting the oldest of them, if the game thread has
+// fallen a whole ring behind; those go to the sink as silence.
+
+static void DrainRing(void)
+{
+    static uint32_t frames[MIXBLOCK];
+    unsigned int head;
+    unsigned int n;
+
+    head = __atomic_load_n(&ringhead, __ATOMIC_ACQUIRE);
+
+    if (wavfile == NULL)
+    {
+        ringtail = head;
+        return;
+    }
+
+    while (ringtail != head)
+    {
+        if (head - ringtail > RINGFRAMES - MIXBLOCK)
+        {
+            n = head - ringtail - (RINGFRAMES - MIXBLOCK);
+            SinkFrames(NULL, n);
+            ringtail += n;
+            continue;
+        }
+
+        n = RINGFRAMES - (ringtail & (RINGFRAMES - 1));
+        if (n > MIXBLOCK)
+        {
+            n = MIXBLOCK;
+        }
+        if (n > head - ringtail)
+        {
+            n = head - ringtail;
+        }
+
+        memcpy(frames, ringbuf + (ringtail & (RINGFRAMES - 1)),
+               n * sizeof(uint32_t));
+
+        // Still there after the copy?
+
+        if (__atomic_load_n(&ringhead, __ATOMIC_ACQUIRE) - ringtail
+              > RINGFRAMES - MIXBLOCK)
+        {
+            SinkFrames(NULL, n);
+        }
+        else
+        {
+            SinkFrames((int16_t *) frames, n);
+        }
+
+        ringtail += n;
+    }
+}
+
+//
+// Commands
+//
+
+// Post a command for the mixer; false if the ring is full.
+
+static boolean PostCommand(const mixcmd_t *cmd)
+{
+    unsigned int tail = __atomic_load_n(&cmdtail, __ATOMIC_ACQUIRE);
+
+    if (!sound_initialized || cmdhead - tail >= CMDRINGSIZE)
+    {
+        return false;
+    }
+
+    cmdring[cmdhead & (CMDRINGSIZE - 1)] = *cmd;
+    __atomic_store_n(&cmdhead, cmdhead + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// Release the sounds the mixer has stopped playing.
+
+static void ReleaseDoneSounds(void)
+{
+    unsigned int head = __atomic_load_n(&donehead, __ATOMIC_ACQUIRE);
+    unsigned int tail = donetail;
+    mixdone_t *done;
+
+    while (tail != head)
+    {
+        done = &donering[tail & (DONERINGSIZE - 1)];
+
+        --done->sound->use_count;
+        ReleaseSound(done->sound);
+
+        if (done->serial == channel_serial[done->channel])
+        {
+            channel_playing[done->channel] = false;
+        }
+
+        ++tail;
+    }
+
+    __atomic_store_n(&donetail, tail, __ATOMIC_RELEASE);
+}
+
+// Run the posted commands, in the mixer. Every command can hand back
+// at most one sound, so a command only runs while donering has room
+// for it and one sound from each channel.
+
+static void RunCommands(void)
+{
+    unsigned int head = __atomic_load_n(&cmdhead, __ATOMIC_ACQUIRE);
+    mixcmd_t *cmd;
+    mixchannel_t *c;
+
+    while (cmdtail != head
+        && donehead - __atomic_load_n(&donetail, __ATOMIC_ACQUIRE)
+             < DONERINGSIZE - MIXCHANNELS)
+    {
+        cmd = &cmdring[cmdtail & (CMDRINGSIZE - 1)];
+        c = &channels[cmd->channel];
+
+        switch (cmd->type)
+        {
+            case MIXCMD_START:
+                DropChannel(cmd->channel);
+                c->sound = cmd->sound;
+                c->serial = cmd->serial;
+                c->pos = 0;
+                c->gain_left = cmd->gain_left;
+                c->gain_right = cmd->gain_right;
+                break;
+
+            case MIXCMD_STOP:
+                if (c->serial == cmd->serial)
+                {
+                    DropChannel(cmd->channel);
+                }
+                break;
+
+            case MIXCMD_PARAMS:
+                c->gain_left = cmd->gain_left;
+                c->gain_right = cmd->gain_right;
+                break;
+
+            case MIXCMD_MUSIC:
+                cmd->func(cmd->data, cmd->arg);
+                break;
+        }
+
+        __atomic_store_n(&cmdtail, cmdtail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+//
+// Mixer
+//
+
+// Mix ahead of the output. Called from a timer interrupt, often
+// enough that the output never catches up with lookahead.
+
+void I_MixSoundTick(void)
+{
+    uint64_t now;
+    unsigned int played;
+    unsigned int pos, n;
+
+    if (!__atomic_load_n(&sound_initialized, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    now = I_GetTimeUS();
+
+    // The output starts with the first tick.
+
+    if (mixstart == 0)
+    {
+        mixstart = now;
+    }
+
+    RunCommands();
+
+    // Frames the output has played by now.
+
+    played = (unsigned int) ((now - mixstart) * snd_samplerate / 1000000);
+
+    if ((int) (played - ringhead) > 0)
+    {
+        pos = played - ringhead > RINGFRAMES ? played - RINGFRAMES : ringhead;
+
+        for (; pos != played; pos += n)
+        {
+            n = RINGFRAMES - (pos & (RINGFRAMES - 1));
+            if (n > played - pos)
+            {
+                n = played - pos;
+            }
+
+            memset(ringbuf + (pos & (RINGFRAMES - 1)), 0, n * sizeof(uint32_t));
+        }
+
+        __atomic_store_n(&ringhead, played, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&mixunderruns, 1, __ATOMIC_RELAXED);
+    }
+
+    while ((int) (played + lookahead - ringhead) > 0)
+    {
+        n = RINGFRAMES - (ringhead & (RINGFRAMES - 1));
+        if (n > MIXBLOCK)
+        {
+            n = MIXBLOCK;
+        }
+        if (n > played + lookahead - ringhead)
+        {
+            n = played + lookahead - ringhead;
+        }
+
+        MixBlock(ringbuf + (ringhead & (RINGFRAMES - 1)), n);
+        __atomic_store_n(&ringhead, ringhead + n, __ATOMIC_RELEASE);
+    }
+
+    __atomic_fetch_add(&mixtime, (uint32_t) (I_GetTimeUS() - now),
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&mixticks, 1, __ATOMIC_RELAXED);
+}
+
+//
+// Sound module
+//
+
+static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
+{
+    // Linked sfx lumps? Get the lump number for the sound linked to.
+
+    if (sfx->link != NULL)
+    {
+        sfx = sfx->link;
+    }
+
+    // Doom adds a DS* prefix to sound lumps; Heretic and Hexen don't
+    // do this.
+
+    if (use_sfx_prefix)
+    {
+        M_snprintf(buf, buf_len, "ds%s", sfx->name);
+    }
+    else
+    {
+        M_StringCopy(buf, sfx->name, buf_len);
+    }
+}
+
+static int I_MIX_GetSfxLumpNum(sfxinfo_t *sfx)
+{
+    char namebuf[9];
+
+    GetSfxLumpName(sfx, namebuf, sizeof(namebuf));
+
+    return W_GetNumForName(namebuf);
+}
+
+// vol is 0-127 and sep 0-254; full volume to one side is 1.0.
+
+static void SetGains(mixcmd_t *cmd, int vol, int sep)
+{
+    cmd->gain_left = ((254 - sep) * vol << GAINBITS) / (254 * 127);
+    cmd->gain_right = (sep * vol << GAINBITS) / (254 * 127);
+}
+
+static void I_MIX_UpdateSoundParams(int handle, int vol, int sep)
+{
+    mixcmd_t cmd;
+
+    if (handle < 0 || handle >= MIXCHANNELS)
+    {
+        return;
+    }
+
+    cmd.type = MIXCMD_PARAMS;
+    cmd.channel = handle;
+    SetGains(&cmd, vol, sep);
+
+    PostCommand(&cmd);
+}
+
+static int I_MIX_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep)
+{
+    cachedsound_t *sound;
+    mixcmd_t cmd;
+
+    if (channel < 0 || channel >= MIXCHANNELS)
+    {
+        return -1;
+    }
+
+    sound = CacheSound(sfxinfo, sfxinfo->lumpnum, true);
+
+    if (sound == NULL)
+    {
+        return -1;
+    }
+
+    // The mixer hands back whatever the channel was playing.
+
+    cmd.type = MIXCMD_START;
+    cmd.channel = channel;
+    cmd.sound = sound;
+    cmd.serial = channel_serial[channel] + 1;
+    SetGains(&cmd, vol, sep);
+
+    ++sound->use_count;
+
+    if (!PostCommand(&cmd))
+    {
+        --sound->use_count;
+        ReleaseSound(sound);
+        return -1;
+    }
+
+    channel_serial[channel] = cmd.serial;
+    channel_playing[channel] = true;
+
+    return channel;
+}
+
+static void I_MIX_StopSound(int handle)
+{
+    mixcmd_t cmd;
+
+    if (handle < 0 || handle >= MIXCHANNELS || !channel_playing[handle])
+    {
+        return;
+    }
+
+    cmd.type = MIXCMD_STOP;
+    cmd.channel = handle;
+    cmd.serial = channel_serial[handle];
+
+    if (PostCommand(&cmd))
+    {
+        channel_playing[handle] = false;
+    }
+}
+
+static boolean I_MIX_SoundIsPlaying(int handle)
+{
+    if (handle < 0 || handle >= MIXCHANNELS)
+    {
+        return false;
+    }
+
+    return channel_playing[handle];
+}
+
+static void I_MIX_UpdateSound(void)
+{
+    ReleaseDoneSounds();
+    DrainRing();
+}
+
+// Convert sounds at startup while they fit in the cache.
+
+static void I_MIX_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
+{
+    char namebuf[9];
+    cachedsound_t *sound;
+    int lumpnum;
+    int i;
+
+    for (i=0; i<num_sounds; ++i)
+    {
+        GetSfxLumpName(&sounds[i], namebuf, sizeof(namebuf));
+        lumpnum = W_CheckNumForName(namebuf);
+
+        if (lumpnum < 0)
+        {
+            continue;
+        }
+
+        sound = CacheSound(&sounds[i], lumpnum, false);
+
+        if (sound != NULL)
+        {
+            ReleaseSound(sound);
+        }
+    }
+
+    printf("I_MIX_PrecacheSounds: %i KB of sound effects in %i ms\n",
+           CacheSize() / 1024, (int) (converttime / 1000));
+}
+
+static boolean I_MIX_InitSound(boolean _use_sfx_prefix)
+{
+    int p;
+
+    use_sfx_prefix = _use_sfx_prefix;
+
+    memset(channels, 0, sizeof(channels));
+    memset(channel_playing, 0, sizeof(channel_playing));
+
+    cmdhead = cmdtail = 0;
+    donehead = donetail = 0;
+
+    if (snd_samplerate < 8000 || snd_samplerate > 96000)
+    {
+        snd_samplerate = 44100;
+    }
+
+    lookahead = snd_maxslicetime_ms * snd_samplerate / 1000;
+
+    if (lookahead < MIXBLOCK)
+    {
+        lookahead = MIXBLOCK;
+    }
+    else if (lookahead > RINGFRAMES / 2)
+    {
+        lookahead = RINGFRAMES / 2;
+    }
+
+    //!
+    // @arg <file>
+    //
+    // Write the mixed sound effects and music to a WAV file.
+    //
+
+    p = M_CheckParmWithArgs("-wavout", 1);
+
+    if (p)
+    {
+        wavfile = fopen(myargv[p + 1], "wb");
+
+        if (wavfile == NULL)
+        {
+            I_Error("I_MIX_InitSound: Unable to open %s", myargv[p + 1]);
+        }
+
+        WriteWAVHeader();
+    }
+
+    ringhead = ringtail = 0;
+    mixstart = 0;
+
+    // The mixer can run from here on.
+
+    __atomic_store_n(&sound_initialized, true, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static void I_MIX_ShutdownSound(void)
+{
+    mixcmd_t *cmd;
+    int i;
+
+    // Stop the mixer, then take back the sounds it still has.
+
+    __atomic_store_n(&sound_initialized, false, __ATOMIC_RELEASE);
+
+    ReleaseDoneSounds();
+
+    for (i=0; i<MIXCHANNELS; ++i)
+    {
+        if (channels[i].sound != NULL)
+        {
+            --channels[i].sound->use_count;
+            ReleaseSound(channels[i].sound);
+            channels[i].sound = NULL;
+        }
+    }
+
+    for (; cmdtail != cmdhead; ++cmdtail)
+    {
+        cmd = &cmdring[cmdtail & (CMDRINGSIZE - 1)];
+
+        if (cmd->type == MIXCMD_START)
+        {
+            --cmd->sound->use_count;
+            ReleaseSound(cmd->sound);
+        }
+    }
+
+    if (wavfile != NULL)
+    {
+        DrainRing();
+        WriteWAVHeader();
+        fclose(wavfile);
+        wavfile = NULL;
+    }
+}
+
+// Have the mixer add music from callback to every block, or stop
+// it with NULL. Fails if the mixer is not running.
+
+boolean I_MixHookMusic(mixmusic_callback_t callback)
+{
+    if (!sound_initialized && callback != NULL)
+    {
+        return false;
+    }
+
+    __atomic_store_n(&mixmusic, callback, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// Have the mixer call func(data, arg) before it next mixes, in order
+// with the sound effect commands. Waits for room in the ring rather
+// than lose the command; fails if the mixer is not running.
+
+boolean I_MixRunMusicCommand(mixmusic_command_t func, void *data, int arg)
+{
+    mixcmd_t cmd;
+
+    if (!sound_initialized)
+    {
+        return false;
+    }
+
+    cmd.type = MIXCMD_MUSIC;
+    cmd.channel = 0;
+    cmd.func = func;
+    cmd.data = data;
+    cmd.arg = arg;
+
+    while (!PostCommand(&cmd))
+    {
+        ReleaseDoneSounds();
+    }
+
+    return true;
+}
+
+// Wait until the mixer has run every command posted so far.
+
+void I_MixSync(void)
+{
+    unsigned int head = cmdhead;
+
+    if (!sound_initialized)
+    {
+        return;
+    }
+
+    while ((int) (__atomic_load_n(&cmdtail, __ATOMIC_ACQUIRE) - head) < 0)
+    {
+        ReleaseDoneSounds();
+    }
+}
+
+// Average time spent mixing per tick and number of underruns
+// since the last call.
+
+void I_MixSoundStats(int *mixus, int *underruns)
+{
+    uint32_t time = __atomic_exchange_n(&mixtime, 0, __ATOMIC_RELAXED);
+    uint32_t ticks = __atomic_exchange_n(&mixticks, 0, __ATOMIC_RELAXED);
+
+    *mixus = ticks ? (int) (time / ticks) : 0;
+    *underruns = (int) __atomic_exchange_n(&mixunderruns, 0, __ATOMIC_RELAXED);
+}
+
+// Conversion time, cache hit rate and size since the last call.
+
+void I_MixSoundCacheStats(int *convertus, int *hitrate, int *cachekb)
+{
+    int lookups = cachehits + cachemisses;
+
+    *convertus = (int) converttime;
+    *hitrate = lookups ? cachehits * 100 / lookups : 100;
+    *cachekb = CacheSize() / 1024;
+
+    converttime = 0;
+    cachehits = 0;
+    cachemisses = 0;
+}
+
+static snddevice_t sound_mix_devices[] =
+{
+    SNDDEVICE_SB,
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_AWE32,
+};
+
+sound_module_t sound_mix_module =
+{
+    sound_mix_devices,
+    arrlen(sound_mix_devices),
+    I_MIX_InitSound,
+    I_MIX_ShutdownSound,
+    I_MIX_GetSfxLumpNum,
+    I_MIX_UpdateSound,
+    I_MIX_UpdateSoundParams,
+    I_MIX_StartSound,
+    I_MIX_StopSound,
+    I_MIX_SoundIsPlaying,
+    I_MIX_PrecacheSounds,
+};
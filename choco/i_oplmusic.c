@@ -0,0 +1,955 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	MUS music playback on the OPL2 emulator.
+//
+//	MUS lumps are played directly, without converting them to MIDI,
+//	using the GENMIDI lump for the instruments, as the DMX library
+//	did on an Adlib or Sound Blaster.
+//
+//	The music is synthesised inside the sound effect mixer, at
+//	snd_musicsamples samples per tic, and interpolated up to
+//	snd_samplerate. The cost of the synth only depends on that rate,
+//	not on the song, so snd_musicsamples is a hard CPU budget.
+//
+//	Everything that touches the synth runs in the mixer; the module
+//	functions have the mixer run them as commands.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "doomtype.h"
+
+#include "i_sound.h"
+#include "i_swap.h"
+#include "i_timer.h"
+#include "opl2.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#define GENMIDI_HEADER          "#OPL_II#"
+#define GENMIDI_NUM_INSTRS      128
+#define GENMIDI_NUM_PERCUSSION  47
+
+#define GENMIDI_FLAG_FIXED      0x0001  // fixed pitch
+#define GENMIDI_FLAG_2VOICE     0x0004  // double voice (OPL3)
+
+#define MUS_HEADER              "MUS\x1a"
+#define MUS_CHANNELS            16
+#define MUS_PERCUSSION_CHAN     15
+#define MUS_TICRATE             140
+
+#define OPL_NUM_VOICES          9
+
+// Synthesised samples for one pass of the output loop.
+#define SYNTHBLOCK              64
+
+typedef struct
+{
+    byte tremolo;
+    byte attack;
+    byte sustain;
+    byte waveform;
+    byte scale;
+    byte level;
+} PACKEDATTR genmidi_op_t;
+
+typedef struct
+{
+    genmidi_op_t modulator;
+    byte feedback;
+    genmidi_op_t carrier;
+    byte unused;
+    short base_note_offset;
+} PACKEDATTR genmidi_voice_t;
+
+typedef struct
+{
+    unsigned short flags;
+    byte fine_tuning;
+    byte fixed_note;
+
+    genmidi_voice_t voices[2];
+} PACKEDATTR genmidi_instr_t;
+
+typedef struct
+{
+    byte id[4];
+    unsigned short scorelen;
+    unsigned short scorestart;
+} PACKEDATTR musheader_t;
+
+typedef struct
+{
+    const byte *score;
+    unsigned int scorelen;
+} opl_song_t;
+
+typedef struct
+{
+    const genmidi_instr_t *instrument;
+    int volume;                 // controller 3
+    int note_volume;            // of the last note played
+    int bend;                   // 1/32 semitones
+} opl_channel_t;
+
+typedef struct
+{
+    int index;                  // OPL channel
+    boolean active;
+    unsigned int age;           // for stealing the oldest voice
+
+    opl_channel_t *channel;
+    int key;                    // MUS note
+    int note_volume;
+
+    const genmidi_instr_t *instrument;
+    int instr_voice;            // 0 or 1, for double voice
+} opl_voice_t;
+
+// Operator registers of the modulator of each OPL channel; the
+// carrier is three further on.
+
+static const int voice_operators[OPL_NUM_VOICES] =
+{
+    0x00, 0x01, 0x02, 0x08, 0x09, 0x0a, 0x10, 0x11, 0x12
+};
+
+static const genmidi_instr_t *main_instrs;
+static const genmidi_instr_t *percussion_instrs;
+static int genmidi_lump = -1;
+
+static opl_channel_t channels[MUS_CHANNELS];
+static opl_voice_t voices[OPL_NUM_VOICES];
+static unsigned int voice_age;
+
+static int music_volume = 127;
+
+// Attenuation of a MIDI volume in OPL level steps (0.75 dB).
+static byte volume_atten[128];
+
+// Frequency numbers at block 4 for the octave up from middle C,
+// in 1/32 semitones.
+static unsigned short fnum_table[12 * 32];
+
+// Playback state. score_pos is NULL when no song is playing.
+
+static const opl_song_t *song;
+static const byte *score_pos;
+static boolean song_looping;
+static boolean song_delayed;    // a delay was seen since the start
+static boolean music_paused;
+static boolean music_playing;   // score_pos != NULL, for the game thread
+
+static int synth_rate;
+static uint32_t mustick_samples;        // 16.16 synth samples per MUS tick
+static uint64_t event_wait;             // 16.16 synth samples
+
+// Interpolation from synth_rate to snd_samplerate.
+
+static uint32_t resample_step;          // 16.16
+static uint32_t resample_pos;
+static int resample_prev, resample_cur;
+static int16_t synth_buf[SYNTHBLOCK + 1];
+
+// Synth cost since the last I_OPLMusicStats.
+static uint32_t synth_time;
+
+//
+// OPL voices
+//
+
+static void WriteOperator(int op, const genmidi_op_t *data, int level)
+{
+    OPL2_WriteRegister(0x40 + op, level);
+    OPL2_WriteRegister(0x20 + op, data->tremolo);
+    OPL2_WriteRegister(0x60 + op, data->attack);
+    OPL2_WriteRegister(0x80 + op, data->sustain);
+    OPL2_WriteRegister(0xe0 + op, data->waveform);
+}
+
+static int OperatorLevel(const genmidi_op_t *data, int atten)
+{
+    int level = (data->level & 0x3f) + atten;
+
+    if (level > 0x3f)
+    {
+        level = 0x3f;
+    }
+
+    return level | (data->scale & 0xc0);
+}
+
+// Attenuation for a voice, from the note, channel and music volumes.
+
+static int VoiceAtten(opl_voice_t *voice)
+{
+    int atten = volume_atten[voice->note_volume]
+              + volume_atten[voice->channel->volume]
+              + volume_atten[music_volume];
+
+    return atten > 0x3f ? 0x3f : atten;
+}
+
+static void SetVoiceVolume(opl_voice_t *voice)
+{
+    const genmidi_voice_t *gm_voice =
+        &voice->instrument->voices[voice->instr_voice];
+    int op = voice_operators[voice->index];
+    int atten = VoiceAtten(voice);
+
+    OPL2_WriteRegister(0x40 + op + 3, OperatorLevel(&gm_voice->carrier, atten));
+
+    // In additive mode the modulator is heard too.
+
+    if (gm_voice->feedback & 1)
+    {
+        OPL2_WriteRegister(0x40 + op, OperatorLevel(&gm_voice->modulator, atten));
+    }
+}
+
+static void SetVoiceInstrument(opl_voice_t *voice)
+{
+    const genmidi_voice_t *gm_voice =
+        &voice->instrument->voices[voice->instr_voice];
+    int op = voice_operators[voice->index];
+
+    WriteOperator(op, &gm_voice->modulator,
+                  OperatorLevel(&gm_voice->modulator, 0));
+    WriteOperator(op + 3, &gm_voice->carrier, 0x3f);
+    OPL2_WriteRegister(0xc0 + voice->index, gm_voice->feedback);
+
+    SetVoiceVolume(voice);
+}
+
+static void WriteFrequency(opl_voice_t *voice, boolean keyon)
+{
+    const genmidi_voice_t *gm_voice =
+        &voice->instrument->voices[voice->instr_voice];
+    int note, index, block, fnum;
+
+    if (SHORT(voice->instrument->flags) & GENMIDI_FLAG_FIXED)
+    {
+        note = voice->instrument->fixed_note;
+    }
+    else
+    {
+        note = voice->key + SHORT(gm_voice->base_note_offset);
+    }
+
+    index = note * 32 + voice->channel->bend;
+
+    if (voice->instr_voice != 0)
+    {
+        index += voice->instrument->fine_tuning / 2 - 64;
+    }
+
+    if (index < 0)
+    {
+        index = 0;
+    }
+
+    // fnum_table is octave 5 (middle C) at block 4.
+
+    block = index / (12 * 32) - 1;
+    fnum = fnum_table[index % (12 * 32)];
+
+    if (block < 0)
+    {
+        fnum >>= -block;
+        block = 0;
+    }
+    else if (block > 7)
+    {
+        fnum <<= block - 7;
+        block = 7;
+    }
+
+    if (fnum > 0x3ff)
+    {
+        fnum = 0x3ff;
+    }
+
+    OPL2_WriteRegister(0xa0 + voice->index, fnum & 0xff);
+    OPL2_WriteRegister(0xb0 + voice->index,
+                       (fnum >> 8) | (block << 2) | (keyon ? 0x20 : 0));
+}
+
+static void VoiceKeyOff(opl_voice_t *voice)
+{
+    WriteFrequency(voice, false);
+    voice->active = false;
+}
+
+// A free voice, or the oldest one if steal is set and none is free.
+
+static opl_voice_t *GetVoice(boolean steal)
+{
+    opl_voice_t *oldest = NULL;
+    int i;
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (!voices[i].active)
+        {
+            return &voices[i];
+        }
+
+        if (oldest == NULL || voices[i].age < oldest->age)
+        {
+            oldest = &voices[i];
+        }
+    }
+
+    if (!steal)
+    {
+        return NULL;
+    }
+
+    VoiceKeyOff(oldest);
+
+    return oldest;
+}
+
+static void VoiceKeyOn(opl_channel_t *channel,
+                       const genmidi_instr_t *instrument, int instr_voice,
+                       int key, int volume)
+{
+    opl_voice_t *voice = GetVoice(instr_voice == 0);
+
+    if (voice == NULL)
+    {
+        return;
+    }
+
+    voice->active = true;
+    voice->age = voice_age++;
+    voice->channel = channel;
+    voice->key = key;
+    voice->note_volume = volume;
+    voice->instrument = instrument;
+    voice->instr_voice = instr_voice;
+
+    SetVoiceInstrument(voice);
+    WriteFrequency(voice, true);
+}
+
+static void AllVoicesOff(void)
+{
+    int i;
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].active)
+        {
+            VoiceKeyOff(&voices[i]);
+        }
+    }
+}
+
+//
+// MUS events
+//
+
+static void ResetChannels(void)
+{
+    int i;
+
+    for (i=0; i<MUS_CHANNELS; ++i)
+    {
+        channels[i].instrument = &main_instrs[0];
+        channels[i].volume = 127;
+        channels[i].note_volume = 127;
+        channels[i].bend = 0;
+    }
+}
+
+static void NoteOn(int ch, int key, int volume)
+{
+    opl_channel_t *channel = &channels[ch];
+    const genmidi_instr_t *instrument;
+
+    if (ch == MUS_PERCUSSION_CHAN)
+    {
+        if (key < 35 || key > 81)
+        {
+            return;
+        }
+
+        instrument = &percussion_instrs[key - 35];
+    }
+    else
+    {
+        instrument = channel->instrument;
+    }
+
+    VoiceKeyOn(channel, instrument, 0, key, volume);
+
+    if (SHORT(instrument->flags) & GENMIDI_FLAG_2VOICE)
+    {
+        VoiceKeyOn(channel, instrument, 1, key, volume);
+    }
+}
+
+static void NoteOff(int ch, int key)
+{
+    int i;
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].active && voices[i].channel == &channels[ch]
+         && voices[i].key == key)
+        {
+            VoiceKeyOff(&voices[i]);
+        }
+    }
+}
+
+static void UpdateChannelVoices(int ch, boolean volume)
+{
+    int i;
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].active && voices[i].channel == &channels[ch])
+        {
+            if (volume)
+            {
+                SetVoiceVolume(&voices[i]);
+            }
+            else
+            {
+                WriteFrequency(&voices[i], true);
+            }
+        }
+    }
+}
+
+static void StopPlayback(void)
+{
+    AllVoicesOff();
+    score_pos = NULL;
+    __atomic_store_n(&music_playing, false, __ATOMIC_RELAXED);
+}
+
+// Byte at the play position, or -1 at the end of the score.
+
+static int ReadByte(void)
+{
+    if (score_pos >= song->score + song->scorelen)
+    {
+        return -1;
+    }
+
+    return *score_pos++;
+}
+
+// Play the events up to the next delay, and add it to event_wait.
+
+static void ProcessEvents(void)
+{
+    int event, ch, type;
+    int data, value;
+    int delay;
+
+    do
+    {
+        event = ReadByte();
+        type = event < 0 ? 6 : (event >> 4) & 7;
+        data = 0;
+
+        // Events other than end of measure and score end have data.
+
+        if (type < 5)
+        {
+            data = ReadByte();
+
+            if (data < 0)
+            {
+                type = 6;
+            }
+        }
+
+        ch = event & 0x0f;
+
+        switch (type)
+        {
+            case 0:             // release note
+                NoteOff(ch, data & 0x7f);
+                break;
+
+            case 1:             // play note, with an optional volume
+                if (data & 0x80)
+                {
+                    value = ReadByte();
+                    channels[ch].note_volume = value < 0 ? 0 : value & 0x7f;
+                }
+                NoteOn(ch, data & 0x7f, channels[ch].note_volume);
+                break;
+
+            case 2:             // pitch bend: 128 is centre, +/-2 semitones
+                channels[ch].bend = (data - 128) / 2;
+                UpdateChannelVoices(ch, false);
+                break;
+
+            case 3:             // system event
+                if (data == 10 || data == 11)
+                {
+                    for (value=0; value<OPL_NUM_VOICES; ++value)
+                    {
+                        if (voices[value].active
+                         && voices[value].channel == &channels[ch])
+                        {
+                            VoiceKeyOff(&voices[value]);
+                        }
+                    }
+                }
+                else if (data == 14)
+                {
+                    channels[ch].volume = 127;
+                    channels[ch].bend = 0;
+                    UpdateChannelVoices(ch, true);
+                    UpdateChannelVoices(ch, false);
+                }
+                break;
+
+            case 4:             // controller
+                value = ReadByte();
+                if (value < 0)
+                {
+                    value = 0;
+                }
+                if (data == 0)
+                {
+                    channels[ch].instrument = &main_instrs[value & 0x7f];
+                }
+                else if (data == 3)
+                {
+                    channels[ch].volume = value & 0x7f;
+                    UpdateChannelVoices(ch, true);
+                }
+                break;
+
+            case 6:             // score end
+                // Start again, unless the song has no delays at all,
+                // which would loop forever.
+                if (song_looping && song_delayed)
+                {
+                    AllVoicesOff();
+                    ResetChannels();
+                    score_pos = song->score;
+                    song_delayed = false;
+                    event = 0;
+                }
+                else
+                {
+                    StopPlayback();
+                    return;
+                }
+                break;
+
+            default:            // end of measure, unused
+                break;
+        }
+    } while ((event & 0x80) == 0);
+
+    // Variable length delay, in MUS ticks.
+
+    delay = 0;
+
+    do
+    {
+        data = ReadByte();
+        delay = (delay << 7) | (data & 0x7f);
+    } while (data >= 0 && (data & 0x80) != 0 && delay < (1 << 21));
+
+    if (delay > 0)
+    {
+        song_delayed = true;
+    }
+
+    event_wait += (uint64_t) delay * mustick_samples;
+}
+
+static void Synthesise(int16_t *buffer, int nsamples)
+{
+    int n;
+
+    while (nsamples > 0)
+    {
+        while (score_pos != NULL && !music_paused && event_wait < 0x10000)
+        {
+            ProcessEvents();
+        }
+
+        n = nsamples;
+
+        if (score_pos != NULL && !music_paused
+         && event_wait < ((uint64_t) n << 16))
+        {
+            n = event_wait >> 16;
+        }
+
+        OPL2_Render(buffer, n);
+
+        if (score_pos != NULL && !music_paused)
+        {
+            event_wait -= (uint64_t) n << 16;
+        }
+
+        buffer += n;
+        nsamples -= n;
+    }
+}
+
+// Mixer hook: synthesise the music and interpolate it to the
+// output rate, into stereo frames.
+
+static void MixMusic(int16_t *out, int frames)
+{
+    uint64_t start = I_GetTimeUS();
+    int needed, used;
+    int n, i;
+
+    while (frames > 0)
+    {
+        n = frames < SYNTHBLOCK ? frames : SYNTHBLOCK;
+
+        // Synth samples the next n output frames step over.
+
+        needed = (resample_pos + (n - 1) * resample_step) >> 16;
+        Synthesise(synth_buf, needed);
+        used = 0;
+
+        for (i=0; i<n; ++i)
+        {
+            while (resample_pos >= 0x10000)
+            {
+                resample_prev = resample_cur;
+                resample_cur = synth_buf[used++];
+                resample_pos -= 0x10000;
+            }
+
+            out[0] = out[1] = resample_prev
+                + (((resample_cur - resample_prev)
+                    * (int) (resample_pos >> 4)) >> 12);
+            out += 2;
+            resample_pos += resample_step;
+        }
+
+        frames -= n;
+    }
+
+    __atomic_fetch_add(&synth_time, (uint32_t) (I_GetTimeUS() - start),
+                       __ATOMIC_RELAXED);
+}
+
+//
+// Music module
+//
+
+static boolean LoadInstruments(void)
+{
+    const byte *lump;
+
+    genmidi_lump = W_CheckNumForName("GENMIDI");
+
+    if (genmidi_lump < 0)
+    {
+        return false;
+    }
+
+    lump = W_CacheLumpNum(genmidi_lump, PU_STATIC);
+
+    if (W_LumpLength(genmidi_lump) < strlen(GENMIDI_HEADER)
+        + (GENMIDI_NUM_INSTRS + GENMIDI_NUM_PERCUSSION) * sizeof(genmidi_instr_t)
+     || strncmp((const char *) lump, GENMIDI_HEADER, strlen(GENMIDI_HEADER)))
+    {
+        W_ReleaseLumpNum(genmidi_lump);
+        genmidi_lump = -1;
+        return false;
+    }
+
+    main_instrs = (const genmidi_instr_t *) (lump + strlen(GENMIDI_HEADER));
+    percussion_instrs = main_instrs + GENMIDI_NUM_INSTRS;
+
+    return true;
+}
+
+static boolean I_OPL_InitMusic(void)
+{
+    int i;
+
+    synth_rate = snd_musicsamples * TICRATE;
+
+    if (synth_rate < 4000)
+    {
+        synth_rate = 4000;
+    }
+    else if (synth_rate > snd_samplerate)
+    {
+        synth_rate = snd_samplerate;
+    }
+
+    if (!LoadInstruments())
+    {
+        return false;
+    }
+
+    if (!I_MixHookMusic(MixMusic))
+    {
+        W_ReleaseLumpNum(genmidi_lump);
+        genmidi_lump = -1;
+        return false;
+    }
+
+    for (i=0; i<128; ++i)
+    {
+        volume_atten[i] = i == 0 ? 0x3f
+            : (byte) (-40 * log10(i / 127.0) / 0.75 + 0.5);
+
+        if (volume_atten[i] > 0x3f)
+        {
+            volume_atten[i] = 0x3f;
+        }
+    }
+
+    for (i=0; i<12*32; ++i)
+    {
+        fnum_table[i] = (unsigned short)
+            (261.6256 * pow(2, i / (12 * 32.0)) * 65536 / 49716 + 0.5);
+    }
+
+    OPL2_Init(synth_rate);
+
+    // Enable the waveform select, as DMX does, and the depth bits
+    // off.
+
+    OPL2_WriteRegister(0x01, 0x20);
+    OPL2_WriteRegister(0x08, 0x40);
+    OPL2_WriteRegister(0xbd, 0x00);
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        voices[i].index = i;
+        voices[i].active = false;
+    }
+
+    mustick_samples = ((uint32_t) synth_rate << 16) / MUS_TICRATE;
+    resample_step = ((uint32_t) synth_rate << 16) / snd_samplerate;
+    resample_pos = 0;
+    resample_prev = resample_cur = 0;
+
+    printf("I_OPL_InitMusic: %i Hz OPL2 synth\n", synth_rate);
+
+    return true;
+}
+
+// Mixer commands
+
+static void StopSongCommand(void *data, int arg)
+{
+    StopPlayback();
+}
+
+static void PlaySongCommand(void *data, int looping)
+{
+    StopPlayback();
+    ResetChannels();
+
+    song = data;
+    song_looping = looping;
+    song_delayed = false;
+    score_pos = song->score;
+    event_wait = 0;
+    __atomic_store_n(&music_playing, true, __ATOMIC_RELAXED);
+}
+
+static void UnRegisterSongCommand(void *data, int arg)
+{
+    if (song == data)
+    {
+        StopPlayback();
+        song = NULL;
+    }
+}
+
+static void SetVolumeCommand(void *data, int volume)
+{
+    int i;
+
+    music_volume = volume;
+
+    for (i=0; i<OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].active)
+        {
+            SetVoiceVolume(&voices[i]);
+        }
+    }
+}
+
+static void SetPausedCommand(void *data, int paused)
+{
+    music_paused = paused;
+
+    if (paused)
+    {
+        AllVoicesOff();
+    }
+}
+
+// Have the mixer run a command, or run it here if the mixer has
+// already stopped.
+
+static void RunCommand(mixmusic_command_t func, void *data, int arg)
+{
+    if (!I_MixRunMusicCommand(func, data, arg))
+    {
+        func(data, arg);
+    }
+}
+
+static void I_OPL_ShutdownMusic(void)
+{
+    RunCommand(StopSongCommand, NULL, 0);
+    I_MixHookMusic(NULL);
+    I_MixSync();
+
+    if (genmidi_lump >= 0)
+    {
+        W_ReleaseLumpNum(genmidi_lump);
+        genmidi_lump = -1;
+    }
+}
+
+static void I_OPL_SetMusicVolume(int volume)
+{
+    RunCommand(SetVolumeCommand, NULL,
+               volume < 0 ? 0 : volume > 127 ? 127 : volume);
+}
+
+static void I_OPL_PauseSong(void)
+{
+    RunCommand(SetPausedCommand, NULL, true);
+}
+
+static void I_OPL_ResumeSong(void)
+{
+    RunCommand(SetPausedCommand, NULL, false);
+}
+
+// MUS lumps are played as they are; MIDI music in PWADs is not
+// supported.
+
+static void *I_OPL_RegisterSong(void *data, int len)
+{
+    const musheader_t *header = data;
+    opl_song_t *result;
+    unsigned int start, scorelen;
+
+    if (len < (int) sizeof(musheader_t)
+     || memcmp(header->id, MUS_HEADER, 4) != 0)
+    {
+        return NULL;
+    }
+
+    start = SHORT(header->scorestart);
+    scorelen = SHORT(header->scorelen);
+
+    if (start >= (unsigned int) len)
+    {
+        return NULL;
+    }
+
+    if (scorelen > len - start)
+    {
+        scorelen = len - start;
+    }
+
+    result = Z_Malloc(sizeof(opl_song_t), PU_STATIC, NULL);
+    result->score = (const byte *) data + start;
+    result->scorelen = scorelen;
+
+    return result;
+}
+
+static void I_OPL_UnRegisterSong(void *handle)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    // The mixer must be done with the song before it is freed.
+
+    RunCommand(UnRegisterSongCommand, handle, 0);
+    I_MixSync();
+
+    Z_Free(handle);
+}
+
+static void I_OPL_PlaySong(void *handle, boolean looping)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    __atomic_store_n(&music_playing, true, __ATOMIC_RELAXED);
+    RunCommand(PlaySongCommand, handle, looping);
+}
+
+static void I_OPL_StopSong(void)
+{
+    RunCommand(StopSongCommand, NULL, 0);
+}
+
+static boolean I_OPL_MusicIsPlaying(void)
+{
+    return __atomic_load_n(&music_playing, __ATOMIC_RELAXED);
+}
+
+// Time spent synthesising music since the last call.
+
+void I_OPLMusicStats(int *synthus)
+{
+    *synthus = (int) __atomic_exchange_n(&synth_time, 0, __ATOMIC_RELAXED);
+}
+
+static snddevice_t music_opl_devices[] =
+{
+    SNDDEVICE_ADLIB,
+    SNDDEVICE_SB,
+};
+
+music_module_t music_opl_module =
+{
+    music_opl_devices,
+    arrlen(music_opl_devices),
+    I_OPL_InitMusic,
+    I_OPL_ShutdownMusic,
+    I_OPL_SetMusicVolume,
+    I_OPL_PauseSong,
+    I_OPL_ResumeSong,
+    I_OPL_RegisterSong,
+    I_OPL_UnRegisterSong,
+    I_OPL_PlaySong,
+    I_OPL_StopSong,
+    I_OPL_MusicIsPlaying,
+    NULL,
+};
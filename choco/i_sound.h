@@ -159,6 +159,22 @@ void I_StopSound(int channel);
 boolean I_SoundIsPlaying(int channel);
 void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds);
 
+// Music rendered by the sound effect mixer, as 16-bit stereo frames
+// to add to the sound effects.
+
+typedef void (*mixmusic_callback_t)(int16_t *out, int frames);
+
+boolean I_MixHookMusic(mixmusic_callback_t callback);
+
+// The callback runs in the mixer, which may interrupt the game
+// thread; music modules change what it plays by having the mixer
+// run commands.
+
+typedef void (*mixmusic_command_t)(void *data, int arg);
+
+boolean I_MixRunMusicCommand(mixmusic_command_t func, void *data, int arg);
+void I_MixSync(void);
+
 // Interface for music modules
 
 typedef struct
@@ -230,6 +246,7 @@ extern int snd_musicdevice;
 extern int snd_samplerate;
 extern int snd_cachesize;
 extern int snd_maxslicetime_ms;
+extern int snd_musicsamples;
 extern char *snd_musiccmd;
 
 void I_BindSoundVariables(void);
@@ -20,6 +20,8 @@
 #ifndef __I_TIMER__
 #define __I_TIMER__
 
+#include "doomtype.h"
+
 #define TICRATE 35
 
 // Called by D_DoomLoop,
@@ -29,9 +31,18 @@ int I_GetTime (void);
 // returns current time in ms
 int I_GetTimeMS (void);
 
+// returns monotonic time in microseconds since startup
+uint64_t I_GetTimeUS (void);
+
+// I_GetTimeUS time at which I_GetTimeMS returns ms
+uint64_t I_MSToTimeUS (int ms);
+
 // Pause for a specified number of ms
 void I_Sleep(int ms);
 
+// Pause until I_GetTimeUS reaches a time
+void I_SleepUS(uint64_t until);
+
 // Initialize timer
 void I_InitTimer(void);
 
@@ -107,6 +107,9 @@ int I_GetPaletteIndex(int r, int g, int b);
 void I_UpdateNoBlit (void);
 void I_FinishUpdate (void);
 
+// Gets the time of the last vsync, returns the number so far.
+uint32_t I_GetVsync (uint64_t *time);
+
 void I_ReadScreen (byte* scr);
 
 void I_BeginRead (void);
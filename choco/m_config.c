@@ -801,13 +801,20 @@ static default_t extra_defaults_list[] =
 
     //!
     // Maximum size of the output sound buffer size in milliseconds.
-    // Sound output is generated periodically in slices. Higher values
-    // might be more efficient but will introduce latency to the
-    // sound output. The default is 28ms (one slice per tic with the
-    // 35fps timer).
+    // Sound output is mixed this far ahead of the output. Higher
+    // values survive longer delays in the mixer but will introduce
+    // latency to the sound output. The default is 10ms.
 
     CONFIG_VARIABLE_INT(snd_maxslicetime_ms),
 
+    //!
+    // Number of OPL music samples to synthesise per tic. The synth
+    // runs at 35 times this rate and its cost is proportional to it;
+    // the default of 315 is 11025 Hz.
+    //
+
+    CONFIG_VARIABLE_INT(snd_musicsamples),
+
     //!
     // External command to invoke to perform MIDI playback. If set to
     // the empty string, SDL_mixer's internal MIDI playback is used.
@@ -0,0 +1,532 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Fixed-point OPL2 (YM3812) emulator.
+//
+//	Enough of the chip for the DMX music driver: the nine melodic
+//	channels with their two operators, the four OPL2 waveforms,
+//	feedback, additive mode, key and level scaling, tremolo and
+//	vibrato. Rhythm mode and the timers are not emulated.
+//
+//	Like the chip, operators work on attenuations: the waveform
+//	comes from a log-sine table, the envelope and levels are added
+//	to it, and an exponent table turns the sum into a sample. The
+//	chip runs at 49716 Hz; here the envelope and phase rates are
+//	scaled to the output rate instead, so that a lower rate costs
+//	proportionally less.
+//
+
+#include <math.h>
+#include <string.h>
+
+#include "opl2.h"
+
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+#define OPL_RATE	49716
+
+#define NUM_CHANNELS	9
+
+// Envelope attenuation is in 0.1875 dB steps, 511 being silent,
+// with ENV_SHIFT fraction bits.
+#define ENV_SHIFT	16
+#define ENV_MAX		(511 << ENV_SHIFT)
+
+enum
+{
+    EG_OFF,
+    EG_ATTACK,
+    EG_DECAY,
+    EG_SUSTAIN,
+    EG_RELEASE,
+};
+
+typedef struct
+{
+    uint32_t phase;		// top 10 bits index the waveform
+    uint32_t phase_inc;
+    int env;
+    int state;
+
+    // Registers
+
+    int am, vib, egtype, ksr, mult;
+    int ksl, tl;
+    int ar, dr, sl, rr;
+    int wave;
+
+    // Derived from the registers and the channel frequency
+
+    int tll;			// total level and key scaling, in steps
+    uint32_t attack_inc;
+    uint32_t decay_inc;
+    uint32_t release_inc;
+
+    int out[2];			// last outputs, for feedback
+} opl_op_t;
+
+typedef struct
+{
+    opl_op_t op[2];
+    int fnum, block, keyon;
+    int feedback;
+    int additive;
+} opl_channel_t;
+
+static opl_channel_t channels[NUM_CHANNELS];
+
+static int waveform_enable;
+static int note_select;
+static int am_deep, vib_deep;
+
+static uint32_t am_phase, am_inc;
+static uint32_t vib_phase, vib_inc;
+
+static uint64_t freq_scale;	// 16.16 phase_inc per fnum << block
+static uint16_t logsin_table[256];
+static uint16_t exp_table[256];
+static uint32_t attack_table[64];
+static uint32_t decay_table[64];
+
+// Frequency multiplier, times two.
+
+static const int mult_table[16] =
+{
+    1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30
+};
+
+// Key scale level at block 7, in 1/8 dB, by the top four bits of
+// the frequency number; 6 dB less for each octave lower.
+
+static const int ksl_table[16] =
+{
+    0, 72, 96, 111, 120, 129, 135, 141, 144, 150, 153, 156, 159, 162, 165, 168
+};
+
+// Shift for KSL off, 3, 1.5 and 6 dB/octave.
+
+static const int ksl_shift[4] = { 31, 1, 2, 0 };
+
+// Operators by the low five bits of their register, for channels
+// and operator within channel.
+
+static const int slot_channel[32] =
+{
+    0, 1, 2, 0, 1, 2, -1, -1, 3, 4, 5, 3, 4, 5, -1, -1,
+    6, 7, 8, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static const int slot_op[32] =
+{
+    0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0,
+    0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static uint32_t RateInc(const uint32_t *table, int rate, int ksroffset)
+{
+    int effective;
+
+    if (rate == 0)
+    {
+        return 0;
+    }
+
+    effective = rate * 4 + ksroffset;
+
+    if (effective > 63)
+    {
+        effective = 63;
+    }
+
+    return table[effective];
+}
+
+static void UpdateOperator(opl_channel_t *channel, opl_op_t *op)
+{
+    int ksroffset;
+    int ksl;
+
+    op->phase_inc = (uint32_t) (((uint64_t) (channel->fnum << channel->block)
+                                 * mult_table[op->mult] * freq_scale) >> 16);
+
+    ksl = ksl_table[channel->fnum >> 6] - 48 * (7 - channel->block);
+
+    if (ksl < 0)
+    {
+        ksl = 0;
+    }
+
+    op->tll = op->tl * 4 + ((ksl * 2 / 3) >> ksl_shift[op->ksl]);
+
+    ksroffset = (channel->block << 1)
+              | ((channel->fnum >> (note_select ? 8 : 9)) & 1);
+
+    if (!op->ksr)
+    {
+        ksroffset >>= 2;
+    }
+
+    op->attack_inc = RateInc(attack_table, op->ar, ksroffset);
+    op->decay_inc = RateInc(decay_table, op->dr, ksroffset);
+    op->release_inc = RateInc(decay_table, op->rr, ksroffset);
+}
+
+static void UpdateChannel(opl_channel_t *channel)
+{
+    UpdateOperator(channel, &channel->op[0]);
+    UpdateOperator(channel, &channel->op[1]);
+}
+
+static void KeyOn(opl_channel_t *channel, int keyon)
+{
+    int i;
+
+    if (keyon && !channel->keyon)
+    {
+        for (i=0; i<2; ++i)
+        {
+            channel->op[i].state = EG_ATTACK;
+            channel->op[i].phase = 0;
+        }
+    }
+    else if (!keyon && channel->keyon)
+    {
+        for (i=0; i<2; ++i)
+        {
+            if (channel->op[i].state != EG_OFF)
+            {
+                channel->op[i].state = EG_RELEASE;
+            }
+        }
+    }
+
+    channel->keyon = keyon;
+}
+
+static void WriteOperator(int reg, int value)
+{
+    opl_channel_t *channel;
+    opl_op_t *op;
+    int slot = reg & 0x1f;
+
+    if (slot_channel[slot] < 0)
+    {
+        return;
+    }
+
+    channel = &channels[slot_channel[slot]];
+    op = &channel->op[slot_op[slot]];
+
+    switch (reg & 0xe0)
+    {
+        case 0x20:
+            op->am = (value >> 7) & 1;
+            op->vib = (value >> 6) & 1;
+            op->egtype = (value >> 5) & 1;
+            op->ksr = (value >> 4) & 1;
+            op->mult = value & 0x0f;
+            break;
+
+        case 0x40:
+            op->ksl = (value >> 6) & 3;
+            op->tl = value & 0x3f;
+            break;
+
+        case 0x60:
+            op->ar = (value >> 4) & 0x0f;
+            op->dr = value & 0x0f;
+            break;
+
+        case 0x80:
+            op->sl = (value >> 4) & 0x0f;
+            op->rr = value & 0x0f;
+            break;
+
+        case 0xe0:
+            op->wave = value & 3;
+            break;
+    }
+
+    UpdateOperator(channel, op);
+}
+
+void OPL2_WriteRegister(int reg, int value)
+{
+    opl_channel_t *channel;
+
+    reg &= 0xff;
+    value &= 0xff;
+
+    if (reg == 0x01)
+    {
+        waveform_enable = (value >> 5) & 1;
+    }
+    else if (reg == 0x08)
+    {
+        note_select = (value >> 6) & 1;
+    }
+    else if (reg == 0xbd)
+    {
+        am_deep = (value >> 7) & 1;
+        vib_deep = (value >> 6) & 1;
+    }
+    else if (reg >= 0xa0 && reg <= 0xa8)
+    {
+        channel = &channels[reg - 0xa0];
+        channel->fnum = (channel->fnum & 0x300) | value;
+        UpdateChannel(channel);
+    }
+    else if (reg >= 0xb0 && reg <= 0xb8)
+    {
+        channel = &channels[reg - 0xb0];
+        channel->fnum = (channel->fnum & 0xff) | ((value & 3) << 8);
+        channel->block = (value >> 2) & 7;
+        UpdateChannel(channel);
+        KeyOn(channel, (value >> 5) & 1);
+    }
+    else if (reg >= 0xc0 && reg <= 0xc8)
+    {
+        channel = &channels[reg - 0xc0];
+        channel->feedback = (value >> 1) & 7;
+        channel->additive = value & 1;
+    }
+    else if (reg >= 0x20)
+    {
+        WriteOperator(reg, value);
+    }
+}
+
+// Advance the envelope of an operator by one sample.
+
+static inline void EnvelopeStep(opl_op_t *op)
+{
+    int sustain;
+
+    switch (op->state)
+    {
+        case EG_ATTACK:
+            // Exponential, towards a little beyond full volume
+            op->env -= (int) (((int64_t) (op->env + (16 << ENV_SHIFT))
+                               * op->attack_inc) >> 16);
+            if (op->env <= 0)
+            {
+                op->env = 0;
+                op->state = EG_DECAY;
+            }
+            break;
+
+        case EG_DECAY:
+            sustain = (op->sl == 15 ? 496 : op->sl * 16) << ENV_SHIFT;
+            op->env += op->decay_inc;
+            if (op->env >= sustain)
+            {
+                op->env = sustain;
+                op->state = op->egtype ? EG_SUSTAIN : EG_RELEASE;
+            }
+            break;
+
+        case EG_RELEASE:
+            op->env += op->release_inc;
+            if (op->env >= ENV_MAX)
+            {
+                op->env = ENV_MAX;
+                op->state = EG_OFF;
+            }
+            break;
+    }
+}
+
+// One sample of an operator, phase modulated by pm (in 1/1024ths
+// of a cycle).
+
+static inline int OperatorOutput(opl_op_t *op, int pm, int am)
+{
+    int index = ((op->phase >> 22) + pm) & 0x3ff;
+    int quarter = index & 0xff;
+    int negative = 0;
+    int level;
+    int out;
+
+    switch (waveform_enable ? op->wave : 0)
+    {
+        case 0:                 // sine
+            negative = index & 0x200;
+            // fall through
+        case 2:                 // rectified sine
+            if (index & 0x100)
+                quarter ^= 0xff;
+            break;
+
+        case 1:                 // half sine
+            if (index & 0x200)
+                return 0;
+            if (index & 0x100)
+                quarter ^= 0xff;
+            break;
+
+        case 3:                 // quarter sine pulses
+            if (index & 0x100)
+                return 0;
+            break;
+    }
+
+    level = logsin_table[quarter]
+          + (((op->env >> ENV_SHIFT) + op->tll + (op->am ? am : 0)) << 3);
+
+    if (level >= (12 << 8))
+    {
+        return 0;
+    }
+
+    out = (exp_table[level & 0xff] << 1) >> (level >> 8);
+
+    return negative ? -out : out;
+}
+
+void OPL2_Render(int16_t *buffer, int nsamples)
+{
+    opl_channel_t *channel;
+    opl_op_t *op0, *op1;
+    int am, vib;
+    int sample;
+    int o1, pm;
+    int i, c, t;
+
+    for (i=0; i<nsamples; ++i)
+    {
+        // Tremolo: 3.7 Hz triangle of 1 or 4.8 dB.
+
+        t = am_phase >> 24;
+        t = t < 128 ? t : 255 - t;
+        am = am_deep ? (t * 26) >> 7 : (t * 21) >> 9;
+        am_phase += am_inc;
+
+        // Vibrato: 6.1 Hz triangle of 7 or 14 cents, in 1/65536ths.
+
+        t = vib_phase >> 24;
+        t = t < 64 ? t : t < 192 ? 128 - t : t - 256;
+        vib = (t * (vib_deep ? 530 : 265)) >> 6;
+        vib_phase += vib_inc;
+
+        sample = 0;
+
+        for (c=0; c<NUM_CHANNELS; ++c)
+        {
+            channel = &channels[c];
+            op0 = &channel->op[0];
+            op1 = &channel->op[1];
+
+            if (op0->state == EG_OFF && op1->state == EG_OFF)
+            {
+                continue;
+            }
+
+            pm = channel->feedback
+               ? (op0->out[0] + op0->out[1]) >> (9 - channel->feedback) : 0;
+
+            o1 = OperatorOutput(op0, pm, am);
+            op0->out[1] = op0->out[0];
+            op0->out[0] = o1;
+
+            if (channel->additive)
+            {
+                sample += o1 + OperatorOutput(op1, 0, am);
+            }
+            else
+            {
+                sample += OperatorOutput(op1, o1 * 2, am);
+            }
+
+            op0->phase += op0->phase_inc;
+            op1->phase += op1->phase_inc;
+
+            if (op0->vib)
+            {
+                op0->phase += (int32_t) (((int64_t) op0->phase_inc * vib) >> 16);
+            }
+            if (op1->vib)
+            {
+                op1->phase += (int32_t) (((int64_t) op1->phase_inc * vib) >> 16);
+            }
+
+            EnvelopeStep(op0);
+            EnvelopeStep(op1);
+        }
+
+        if (sample > 32767)
+            sample = 32767;
+        else if (sample < -32768)
+            sample = -32768;
+
+        buffer[i] = sample;
+    }
+}
+
+void OPL2_Init(int samplerate)
+{
+    double k;
+    int i, c;
+
+    memset(channels, 0, sizeof(channels));
+
+    for (c=0; c<NUM_CHANNELS; ++c)
+    {
+        for (i=0; i<2; ++i)
+        {
+            channels[c].op[i].env = ENV_MAX;
+            channels[c].op[i].state = EG_OFF;
+        }
+    }
+
+    waveform_enable = 0;
+    note_select = 0;
+    am_deep = vib_deep = 0;
+    am_phase = vib_phase = 0;
+
+    // The frequency is fnum * 2^block * mult * 49716 / 2^20 Hz.
+
+    freq_scale = ((uint64_t) OPL_RATE << 27) / samplerate;
+
+    am_inc = (uint32_t) (3.7 * 4294967296.0 / samplerate);
+    vib_inc = (uint32_t) (6.1 * 4294967296.0 / samplerate);
+
+    for (i=0; i<256; ++i)
+    {
+        logsin_table[i] = (uint16_t)
+            (-log(sin((i + 0.5) * M_PI / 512)) / log(2) * 256 + 0.5);
+        exp_table[i] = (uint16_t) (pow(2, (255 - i) / 256.0) * 1024 + 0.5);
+    }
+
+    // Envelope rates, from the times the chip takes to go from
+    // silence to full volume or back at the slowest rate (2826 and
+    // 39280 ms); each rate is twice as fast as the one four below.
+    // The attack is exponential and ln(527 / 16) = 3.49 time
+    // constants long.
+
+    for (i=0; i<64; ++i)
+    {
+        k = pow(2, (i - 4) / 4.0);
+
+        attack_table[i] = i >= 60 ? 65536
+                        : (uint32_t) (3.49 * 65536 * k / (2.826 * samplerate));
+
+        if (attack_table[i] > 65536)
+            attack_table[i] = 65536;
+
+        decay_table[i] = (uint32_t) (511.0 * 65536 * k / (39.28 * samplerate));
+    }
+}
+
@@ -0,0 +1,33 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Fixed-point OPL2 (YM3812) emulator.
+//
+
+
+#ifndef __OPL2__
+#define __OPL2__
+
+#include "doomtype.h"
+
+// Reset the chip and produce samplerate samples per second.
+void OPL2_Init(int samplerate);
+
+void OPL2_WriteRegister(int reg, int value);
+
+// Synthesise the next samples, mono.
+void OPL2_Render(int16_t *buffer, int nsamples);
+
+#endif
+
@@ -35,14 +35,22 @@
 int snd_samplerate = 44100;
 
 // Maximum number of bytes to dedicate to allocated sound effects.
-// (Default: 64MB)
+// Converted to 16-bit at snd_samplerate they take 8 times the size
+// of the lumps, and share the zone with everything else.
+// (Default: 2MB)
 
-int snd_cachesize = 64 * 1024 * 1024;
+int snd_cachesize = 2 * 1024 * 1024;
 
-// Config variable that controls the sound buffer size.
-// We default to 28ms (1000 / 35fps = 1 buffer per tic).
+// Config variable that controls the sound buffer size: how far the
+// mixer stays ahead of the output. The mixer runs from a 1 ms timer,
+// so 10ms leaves plenty of margin.
 
-int snd_maxslicetime_ms = 28;
+int snd_maxslicetime_ms = 10;
+
+// OPL music samples to synthesise per tic; the synth runs at 35
+// times this rate. (Default: 315, 11025 Hz)
+
+int snd_musicsamples = 315;
 
 // External command to invoke to play back music.
 
@@ -58,11 +66,13 @@ int snd_sfxdevice = SNDDEVICE_SB;
 
 // Sound modules
 
+extern sound_module_t sound_mix_module;
+extern music_module_t music_opl_module;
+
 #ifdef FEATURE_SOUND
 extern sound_module_t sound_sdl_module;
 extern sound_module_t sound_pcsound_module;
 extern music_module_t music_sdl_module;
-extern music_module_t music_opl_module;
 // For OPL module:
 
 opl_driver_ver_t opl_drv_ver;
@@ -84,6 +94,7 @@ static int snd_mport = 0;
 
 static sound_module_t *sound_modules[] = 
 {
+    &sound_mix_module,
 #ifdef FEATURE_SOUND
     &sound_sdl_module,
     &sound_pcsound_module,
@@ -95,9 +106,9 @@ static sound_module_t *sound_modules[] =
 
 static music_module_t *music_modules[] =
 {
+    &music_opl_module,
 #ifdef FEATURE_SOUND
     &music_sdl_module,
-    &music_opl_module,
 #endif
     NULL,
 };
@@ -157,7 +168,6 @@ static void InitSfxModule(boolean use_sfx_prefix)
 
 static void InitMusicModule(void)
 {
-#ifdef FEATURE_SOUND
     int i;
 
     music_module = NULL;
@@ -180,7 +190,6 @@ static void InitMusicModule(void)
             }
         }
     }
-#endif
 }
 
 //
@@ -446,6 +455,7 @@ void I_BindSoundVariables(void)
     M_BindStringVariable("snd_musiccmd",      &snd_musiccmd);
     M_BindIntVariable("snd_samplerate",    &snd_samplerate);
     M_BindIntVariable("snd_cachesize",     &snd_cachesize);
+    M_BindIntVariable("snd_musicsamples",  &snd_musicsamples);
 
 #ifdef FEATURE_SOUND
     extern int use_libsamplerate;
@@ -23,40 +23,112 @@
 #include "main_stm32f7xx.h"
 
 //
-// I_GetTime
-// returns time in 1/35th second tics
+// I_GetTimeUS
+// Monotonic time in microseconds since the board started, from the
+// DWT cycle counter. CYCCNT wraps every 2^32 cycles, under 20 s at
+// 216 MHz; I_UpdateTimer, called from SysTick every ms, counts the
+// wraps into a 64 bit total so none is ever missed.
 //
 
-static uint32_t basetime = 0;
+static uint32_t lastcycles;
+static uint64_t wrapcycles;     // cycles counted before the last wrap
 
-int  I_GetTime (void)
+// Must be called with interrupts off.
+static uint64_t I_ExtendCycles(uint32_t cycles)
 {
-    uint32_t ticks;
+    if (cycles < lastcycles)
+        wrapcycles += (uint64_t) 1 << 32;
+
+    lastcycles = cycles;
+
+    return wrapcycles + cycles;
+}
+
+// SysTick has the lowest priority, so the LTDC and USART handlers
+// that read the time can preempt it.
+
+void I_UpdateTimer(void)
+{
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    I_ExtendCycles(DWT->CYCCNT);
+    __set_PRIMASK(primask);
+}
 
-    ticks = HAL_GetTick();
+uint64_t I_GetTimeUS(void)
+{
+    uint32_t primask;
+    uint32_t clock;
+    uint64_t cycles;
 
-    if (basetime == 0)
-        basetime = ticks;
+    primask = __get_PRIMASK();
+    __disable_irq();
+    cycles = I_ExtendCycles(DWT->CYCCNT);
+    __set_PRIMASK(primask);
 
-    ticks -= basetime;
+    // split so that cycles * 1000000 cannot overflow
+    clock = SystemCoreClock;
 
-    return (ticks * TICRATE) / 1000;    
+    return (cycles / clock) * 1000000
+         + (cycles % clock) * 1000000 / clock;
 }
 
 //
-// Same as I_GetTime, but returns time in milliseconds
+// I_GetTime and I_GetTimeMS count from their first call. Both are
+// worked out from the same microsecond count, so they never drift
+// apart; the int results wrap (I_GetTimeMS after 24 days), which
+// callers taking differences do not notice.
 //
 
-int I_GetTimeMS(void)
+static uint64_t basetime;
+static boolean basetimeset = false;
+
+static uint64_t I_GetElapsedUS(void)
+{
+    uint64_t now;
+
+    now = I_GetTimeUS();
+
+    if (!basetimeset)
+    {
+        basetime = now;
+        basetimeset = true;
+    }
+
+    return now - basetime;
+}
+
+//
+// I_MSToTimeUS
+// Returns the I_GetTimeUS time at which I_GetTimeMS reaches ms.
+//
+
+uint64_t I_MSToTimeUS(int ms)
 {
-    uint32_t ticks;
+    I_GetElapsedUS();
+
+    return basetime + (int64_t) ms * 1000;
+}
 
-    ticks = HAL_GetTick();
+//
+// I_GetTime
+// returns time in 1/35th second tics
+//
+
+int  I_GetTime (void)
+{
+    return (int) (I_GetElapsedUS() * TICRATE / 1000000);
+}
 
-    if (basetime == 0)
-        basetime = ticks;
+//
+// Same as I_GetTime, but returns time in milliseconds
+//
 
-    return ticks - basetime;
+int I_GetTimeMS(void)
+{
+    return (int) (I_GetElapsedUS() / 1000);
 }
 
 // Sleep for a specified number of ms
@@ -67,6 +139,18 @@ void I_Sleep(int ms)
     HAL_Delay_WFI(ms);
 }
 
+// Sleep until I_GetTimeUS reaches a time. SysTick ends a WFI
+// every ms, so the last one is spun out.
+
+void I_SleepUS(uint64_t until)
+{
+    while (I_GetTimeUS() + 1000 < until)
+        __WFI();
+
+    while (I_GetTimeUS() < until)
+        ;
+}
+
 void I_WaitVBL(int count)
 {
     I_Sleep((count * 1000) / 70);
@@ -14,6 +14,8 @@
 
 #include "config.h"
 // #include "deh_str.h"
+#include "d_event.h"
+#include "d_pacer.h"
 #include "doomtype.h"
 #include "doomkeys.h"
 #include "i_joystick.h"
@@ -228,10 +230,33 @@ void I_FinishUpdate(void)
 {
     BlitDoomFrame(I_VideoBuffer, (uint32_t *)STM32_ScreenBuffer, SCREENWIDTH, SCREENHEIGHT);
     STM32_SignalFrameReady();
+    D_PacerFrameDone(I_GetTimeUS());
 }
 
+extern int DG_GetKey(int* pressed, unsigned char* doomKey, uint64_t* time);
 void I_StartFrame(void) {}
-void I_GetEvent(void) {}
+
+void I_GetEvent(void)
+{
+    event_t event;
+    int pressed;
+    unsigned char key;
+    uint64_t time;
+
+    while (DG_GetKey(&pressed, &key, &time))
+    {
+        event.type = pressed ? ev_keydown : ev_keyup;
+        event.data1 = key;
+        event.data2 = key;
+        event.data3 = key;
+        event.data4 = 0;
+        D_PostEvent(&event);
+
+        if (pressed)
+            D_PacerInput(time); // follow it to the screen
+    }
+}
+
 void I_StartTic(void) { I_GetEvent(); }
 void I_UpdateNoBlit(void) {}
 void I_ReadScreen(byte* scr) { memcpy(scr, I_VideoBuffer, SCREENWIDTH * SCREENHEIGHT); }
@@ -551,6 +551,9 @@ static void DoMerge(void)
     lumpinfo = newlumps;
     numlumps = num_newlumps;
 
+    // The hash table still points into the old directory.
+
+    W_GenerateHashTable();
 }
 
 void W_PrintDirectory(void)
@@ -667,6 +670,8 @@ void W_NWTMergeFile(char *filename, int flags)
     // Discard the PWAD
 
     numlumps = old_numlumps;
+
+    W_GenerateHashTable();
 }
 
 // Simulates the NWT -merge command line parameter.  What this does is load
@@ -712,6 +717,7 @@ void W_NWTDashMerge(char *filename)
             // nwt -merge does.
 
             M_StringCopy(iwad_sprites.lumps[i].name, "", 8);
+            iwad_sprites.lumps[i].key = 0;
         }
     }
 
@@ -720,6 +726,8 @@ void W_NWTDashMerge(char *filename)
 
     numlumps = old_numlumps;
 
+    W_GenerateHashTable();
+
     W_CloseFile(wad_file);
 }
 
@@ -60,8 +60,11 @@ typedef struct
 lumpinfo_t *lumpinfo;
 unsigned int numlumps = 0;
 
-// Hash table for fast lookups
+// Hash table for fast lookups, numlumphash buckets (a power of two).
+// It is kept up to date by W_AddFile, so lookups are hashed from the
+// first WAD on.
 static lumpinfo_t **lumphash;
+static unsigned int numlumphash;
 
 // Variables for the reload hack: filename of the PWAD to reload, and the
 // lumps from WADs before the reload file, so we can resent numlumps and
@@ -87,6 +90,47 @@ unsigned int W_LumpNameHash(const char *s)
     return result;
 }
 
+// Pack a lump name into a 64-bit key: up to 8 characters, upper-cased
+// and zero padded.  Two names match under strncasecmp(a, b, 8) exactly
+// when their keys are equal, so lookups compare a single integer.
+uint64_t W_LumpNameKey(const char *s)
+{
+    uint64_t key = 0;
+    unsigned int i;
+
+    for (i=0; i < 8 && s[i] != '\0'; ++i)
+    {
+        uint64_t c = (unsigned char) s[i];
+
+        if (c >= 'a' && c <= 'z')
+        {
+            c -= 'a' - 'A';
+        }
+
+        key |= c << (i * 8);
+    }
+
+    return key;
+}
+
+// Hash function used for lump keys (Fibonacci hashing, the upper half
+// of the product depends on all 8 characters).
+unsigned int W_LumpKeyHash(uint64_t key)
+{
+    return (unsigned int) ((key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+// Hook a lump into the hash table. Later lumps go to the front of their
+// chain, so PWAD lumps take precedence over IWAD lumps of the same name.
+static void HashLump(lumpinfo_t *lump)
+{
+    unsigned int hash;
+
+    hash = W_LumpKeyHash(lump->key) & (numlumphash - 1);
+    lump->next = lumphash[hash];
+    lumphash[hash] = lump;
+}
+
 // Increase the size of the lumpinfo[] array to the specified size.
 static void ExtendLumpInfo(int newnumlumps)
 {
@@ -112,8 +156,8 @@ static void ExtendLumpInfo(int newnumlumps)
             Z_ChangeUser(newlumpinfo[i].cache, &newlumpinfo[i].cache);
         }
 
-        // We shouldn't be generating a hash table until after all WADs have
-        // been loaded, but just in case...
+        // The hash table is built while WADs are loaded, so the chain
+        // links have to be moved over as well.
         if (lumpinfo[i].next != NULL)
         {
             int nextlumpnum = lumpinfo[i].next - lumpinfo;
@@ -121,6 +165,17 @@ static void ExtendLumpInfo(int newnumlumps)
         }
     }
 
+    if (lumphash != NULL)
+    {
+        for (i = 0; i < numlumphash; ++i)
+        {
+            if (lumphash[i] != NULL)
+            {
+                lumphash[i] = &newlumpinfo[lumphash[i] - lumpinfo];
+            }
+        }
+    }
+
     // All done.
     free(lumpinfo);
     lumpinfo = newlumpinfo;
@@ -249,6 +304,7 @@ wad_file_t *W_AddFile (char *filename)
 	lump_p->size = LONG(filerover->size);
         lump_p->cache = NULL;
 	strncpy(lump_p->name, filerover->name, 8);
+        lump_p->key = W_LumpNameKey(lump_p->name);
 
         ++lump_p;
         ++filerover;
@@ -256,10 +312,18 @@ wad_file_t *W_AddFile (char *filename)
 
     Z_Free(fileinfo);
 
-    if (lumphash != NULL)
+    // Add the new lumps to the hash table. Only rebuild it when the
+    // directory has outgrown the number of buckets.
+    if (lumphash == NULL || numlumps > numlumphash)
     {
-        Z_Free(lumphash);
-        lumphash = NULL;
+        W_GenerateHashTable();
+    }
+    else
+    {
+        for (i=startlump; i<numlumps; ++i)
+        {
+            HashLump(&lumpinfo[i]);
+        }
     }
 
     return wad_file;
@@ -283,6 +347,17 @@ int W_NumLumps (void)
 //
 
 int W_CheckNumForName (char* name)
+{
+    return W_CheckNumForKey(W_LumpNameKey(name));
+}
+
+//
+// W_CheckNumForKey
+// Same as W_CheckNumForName, with the name already packed by
+// W_LumpNameKey.
+//
+
+int W_CheckNumForKey (uint64_t key)
 {
     lumpinfo_t *lump_p;
     int i;
@@ -291,29 +366,30 @@ int W_CheckNumForName (char* name)
 
     if (lumphash != NULL)
     {
-        int hash;
-        
+        unsigned int hash;
+
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
-        
+        hash = W_LumpKeyHash(key) & (numlumphash - 1);
+
         for (lump_p = lumphash[hash]; lump_p != NULL; lump_p = lump_p->next)
         {
-            if (!strncasecmp(lump_p->name, name, 8))
+            if (lump_p->key == key)
             {
                 return lump_p - lumpinfo;
             }
         }
-    } 
+    }
     else
     {
-        // We don't have a hash table generate yet. Linear search :-(
-        // 
+        // The directory was rearranged (WAD merging) and the hash table
+        // is not rebuilt yet. Linear search :-(
+        //
         // scan backwards so patch lump files take precedence
 
         for (i=numlumps-1; i >= 0; --i)
         {
-            if (!strncasecmp(lumpinfo[i].name, name, 8))
+            if (lumpinfo[i].key == key)
             {
                 return i;
             }
@@ -496,6 +572,142 @@ void W_ReleaseLumpName(char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_PreloadLumps
+//
+// Cache a list of lumps with the given tag, reading them in file order.
+// Lumps that lie close together in the same file are read with a single
+// W_Read into a bounce buffer and copied into their cache blocks, which
+// turns a scattered working set into a few sequential reads.
+//
+// The list is sorted in place and may contain duplicates. Returns the
+// number of reads issued.
+//
+
+// Largest read issued for a run of lumps.
+#define PRELOAD_MAX_READ   (64 * 1024)
+
+// Gaps between lumps up to this size are read through.
+#define PRELOAD_MAX_GAP    (4 * 1024)
+
+static int PreloadCompare(const void *a, const void *b)
+{
+    const lumpinfo_t *la = &lumpinfo[*(const int *) a];
+    const lumpinfo_t *lb = &lumpinfo[*(const int *) b];
+
+    if (la->wad_file != lb->wad_file)
+    {
+        return la->wad_file < lb->wad_file ? -1 : 1;
+    }
+
+    if (la->position != lb->position)
+    {
+        return la->position < lb->position ? -1 : 1;
+    }
+
+    return *(const int *) a - *(const int *) b;
+}
+
+int W_PreloadLumps(int *lumplist, int count, int tag)
+{
+    lumpinfo_t *first;
+    lumpinfo_t *lump;
+    byte *buffer;
+    int runend;
+    int reads;
+    int start;
+    int end;
+    int c;
+    int i;
+
+    qsort(lumplist, count, sizeof(*lumplist), PreloadCompare);
+
+    buffer = NULL;
+    reads = 0;
+
+    for (start = 0; start < count; start = end)
+    {
+        first = &lumpinfo[lumplist[start]];
+        end = start + 1;
+
+        if (first->wad_file->mapped != NULL || first->cache != NULL)
+        {
+            // Nothing to read, just apply the tag.
+            W_CacheLumpNum(lumplist[start], tag);
+            continue;
+        }
+
+        // Extend the run while the next lump is uncached, in the same
+        // file and close enough to read through the gap.
+        runend = first->position + first->size;
+
+        while (end < count)
+        {
+            lump = &lumpinfo[lumplist[end]];
+
+            if (lump->wad_file != first->wad_file
+             || lump->cache != NULL
+             || lump->position - runend > PRELOAD_MAX_GAP
+             || lump->position + lump->size - first->position
+                    > PRELOAD_MAX_READ)
+            {
+                break;
+            }
+
+            if (lump->position + lump->size > runend)
+            {
+                runend = lump->position + lump->size;
+            }
+
+            ++end;
+        }
+
+        ++reads;
+
+        if (end - start == 1)
+        {
+            W_CacheLumpNum(lumplist[start], tag);
+            continue;
+        }
+
+        if (buffer == NULL)
+        {
+            buffer = Z_Malloc(PRELOAD_MAX_READ, PU_STATIC, NULL);
+        }
+
+        I_BeginRead();
+        c = W_Read(first->wad_file, first->position, buffer,
+                   runend - first->position);
+
+        if (c < runend - first->position)
+        {
+            I_Error("W_PreloadLumps: only read %i of %i at lump %i",
+                    c, runend - first->position, lumplist[start]);
+        }
+
+        I_EndRead();
+
+        for (i = start; i < end; ++i)
+        {
+            lump = &lumpinfo[lumplist[i]];
+
+            if (lump->cache == NULL)
+            {
+                Z_Malloc(lump->size, tag, &lump->cache);
+                memcpy(lump->cache, buffer + lump->position - first->position,
+                       lump->size);
+            }
+        }
+    }
+
+    if (buffer != NULL)
+    {
+        Z_Free(buffer);
+    }
+
+    return reads;
+}
+
 #if 0
 
 //
@@ -574,23 +786,21 @@ void W_GenerateHashTable(void)
         Z_Free(lumphash);
     }
 
-    // Generate hash table
-    if (numlumps > 0)
-    {
-        lumphash = Z_Malloc(sizeof(lumpinfo_t *) * numlumps, PU_STATIC, NULL);
-        memset(lumphash, 0, sizeof(lumpinfo_t *) * numlumps);
-
-        for (i=0; i<numlumps; ++i)
-        {
-            unsigned int hash;
+    // Generate hash table, with at least one bucket per lump so that
+    // W_AddFile can keep adding lumps without rehashing every time.
+    numlumphash = 1;
 
-            hash = W_LumpNameHash(lumpinfo[i].name) % numlumps;
+    while (numlumphash < numlumps)
+    {
+        numlumphash <<= 1;
+    }
 
-            // Hook into the hash table
+    lumphash = Z_Malloc(sizeof(lumpinfo_t *) * numlumphash, PU_STATIC, NULL);
+    memset(lumphash, 0, sizeof(lumpinfo_t *) * numlumphash);
 
-            lumpinfo[i].next = lumphash[hash];
-            lumphash[hash] = &lumpinfo[i];
-        }
+    for (i=0; i<numlumps; ++i)
+    {
+        HashLump(&lumpinfo[i]);
     }
 
     // All done!
@@ -621,8 +831,10 @@ void W_Reload(void)
         }
     }
 
-    // Reset numlumps to remove the reload WAD file:
+    // Reset numlumps to remove the reload WAD file, and drop its lumps
+    // from the hash table:
     numlumps = reloadlump;
+    W_GenerateHashTable();
 
     // Now reload the WAD file.
     filename = reloadname;
@@ -633,10 +845,6 @@ void W_Reload(void)
     reloadhandle = NULL;
     W_AddFile(filename);
     free(filename);
-
-    // The WAD directory has changed, so we have to regenerate the
-    // fast lookup hashtable:
-    W_GenerateHashTable();
 }
 
 // Lump names that are unique to particular game types. This lets us check
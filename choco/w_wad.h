@@ -41,6 +41,7 @@ typedef struct lumpinfo_s lumpinfo_t;
 struct lumpinfo_s
 {
     char	name[8];
+    uint64_t	key;		// name packed upper-case, see W_LumpNameKey
     wad_file_t *wad_file;
     int		position;
     int		size;
@@ -59,6 +60,7 @@ wad_file_t *W_AddFile (char *filename);
 void    W_Reload (void);
 
 int	W_CheckNumForName (char* name);
+int	W_CheckNumForKey (uint64_t key);
 int	W_GetNumForName (char* name);
 
 int	W_LumpLength (unsigned int lump);
@@ -70,10 +72,14 @@ void*	W_CacheLumpName (char* name, int tag);
 void    W_GenerateHashTable(void);
 
 extern unsigned int W_LumpNameHash(const char *s);
+extern uint64_t W_LumpNameKey(const char *s);
+extern unsigned int W_LumpKeyHash(uint64_t key);
 
 void    W_ReleaseLumpNum(int lump);
 void    W_ReleaseLumpName(char *name);
 
+int     W_PreloadLumps(int *lumplist, int count, int tag);
+
 void W_CheckCorrectIWAD(GameMission_t mission);
 
 #endif